@@ -17,13 +17,31 @@
 
 */
 #include <algorithm>
+#include <atomic>
+#include <cstdlib>
 #include <future>
 #include <iostream>
+#include <new>
 #include <numeric>
 
 // Include the Hwloc C++ wrapper
 #include <hwlocxx>
 
+// Counts allocations, to check that walking the topology does not allocate
+static std::atomic<size_t> allocations{0};
+
+void* operator new(size_t size)
+{
+   allocations++;
+   if (void* ptr = std::malloc(size ? size : 1)) {
+      return ptr;
+   }
+   throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
 
 int main()
 {
@@ -33,15 +51,15 @@ int main()
    // Print topology
    for (auto& c : cList) {
       std::cout << c.name() << std::endl;
-      for (auto& c1 : c.resources()) {
+      for (const auto& c1 : c.resources()) {
          std::cout << " " << c1.name() << std::endl;
-         for (auto& c2 : c1.resources()) {
+         for (const auto& c2 : c1.resources()) {
             std::cout << "  " << c2.name() << std::endl;
-            for (auto& c3 : c2.resources()) {
+            for (const auto& c3 : c2.resources()) {
                std::cout << "   " << c3.name() << std::endl;
-               for (auto& c4 : c3.resources()) {
+               for (const auto& c4 : c3.resources()) {
                   std::cout << "    " << c4.name() << std::endl;
-                  for (auto& c5 : c4.resources()) {
+                  for (const auto& c5 : c4.resources()) {
                      std::cout << "     " << c5.name() << std::endl;
                   }
                }
@@ -50,6 +68,50 @@ int main()
       }
    }
 
+   /* Views over a larger machine: the walks below allocate nothing */
+   hwlocxx::topology topo{
+       hwlocxx::topology::synthetic{"pack:2 numa:2 core:4 pu:2"}};
+   const auto machine = topo.get_obj(0, 0);
+   int errors = 0;
+   const auto before = allocations.load();
+
+   size_t pus = 0;
+   for (auto pu : machine.get_pus()) {
+      pus += (pu.get()->type == HWLOC_OBJ_PU) ? 1 : 0;
+   }
+
+   const auto lastPU = topo.get_object_by_type(HWLOC_OBJ_PU, 31);
+   int ancestors = 0;
+   bool reachesRoot = false;
+   for (auto a : lastPU.get_ancestors()) {
+      ancestors++;
+      reachesRoot = (a.get() == machine.get());
+   }
+
+   size_t cores = 0;
+   for (auto core : topo.get_object_by_type(HWLOC_OBJ_CORE, 3).get_cousins()) {
+      cores += (core.get_type_name() == "Core") ? 1 : 0;
+   }
+
+   size_t packages = 0;
+   for (const auto& r : hwlocxx::experimental::thread_execution_resource_t{
+            machine}.resources()) {
+      packages += (r.name() == "Package") ? 1 : 0;
+   }
+
+   size_t level = 0;
+   for (auto o : topo.get_level(topo.get_depth() - 1)) {
+      level += o.get_children().empty() ? 1 : 0;
+   }
+
+   const auto allocated = allocations.load() - before;
+   std::cout << "Allocations while walking: " << allocated << std::endl;
+   errors += (allocated == 0) ? 0 : 1;
+   errors += (pus == 32 && level == 32) ? 0 : 1;
+   errors += (reachesRoot && ancestors == lastPU.get()->depth) ? 0 : 1;
+   errors += (cores == 16 && packages == 2) ? 0 : 1;
+   return errors;
+
 #if 0
    // hwloc-based ExecutorContext
    hwlocxx::experimental::ExecutionContext hwEC;
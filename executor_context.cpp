@@ -17,9 +17,12 @@
 
 */
 #include <algorithm>
+#include <atomic>
+#include <functional>
 #include <future>
 #include <iostream>
 #include <numeric>
+#include <type_traits>
 
 // Include the Hwloc C++ wrapper
 #include <hwlocxx>
@@ -46,5 +49,192 @@ int main()
       return 42u;
    });
 
-   return (42 - fut.get());
+   /* Keep one PU per core for latency-critical work */
+   const auto reserved =
+       hwlocxx::experimental::first_in_each(eR.get_object(), HWLOC_OBJ_CORE);
+   hwEC.reserve(reserved);
+   auto urgent = mE.twoway_execute(hwlocxx::experimental::priority::latency,
+                                   []() -> unsigned { return 7u; });
+
+   /* Run a task near a buffer allocated on the last NUMA node */
+   auto topo = hwEC.get_topology();
+   auto n = topo.get_width_by_type(HWLOC_OBJ_NUMANODE);
+   auto node = topo.get_object_by_type(HWLOC_OBJ_NUMANODE, n - 1);
+   hwlocxx::allocator<unsigned> a{topo, node};
+   std::vector<unsigned, hwlocxx::allocator<unsigned>> v{10u, 1u, a};
+
+   auto nearFut = mE.twoway_execute_near(v.data(), [&]() -> unsigned {
+      return std::accumulate(std::begin(v), std::end(v), 0u);
+   });
+
+   /* Count tasks per PU and per NUMA node from inside the workers */
+   hwlocxx::experimental::per_pu<unsigned> puTasks{eR, 0u};
+   // Workers of a node share its slot
+   hwlocxx::experimental::per_numa<std::atomic<unsigned>> nodeTasks{eR, 0u};
+   const unsigned nTasks = 16u;
+   std::vector<std::future<unsigned>> counted;
+   for (unsigned i = 0; i < nTasks; i++) {
+      counted.push_back(mE.twoway_execute([&]() -> unsigned {
+         puTasks.local()++;
+         nodeTasks.local()++;
+         return 1u;
+      }));
+   }
+   for (auto& f : counted) {
+      f.get();
+   }
+   unsigned puTotal = 0u;
+   puTasks.for_each([&](unsigned c) { puTotal += c; });
+   unsigned nodeTotal = 0u;
+   nodeTasks.for_each(
+       [&](const std::atomic<unsigned>& c) { nodeTotal += c.load(); });
+
+   /* Fan out many small tasks with a single submission */
+   std::atomic<unsigned> batchCount{0u};
+   std::vector<std::function<void()>> batch(100u, [&]() { batchCount++; });
+   mE.execute_batch(batch).get();
+
+   /* Executor properties are types: the behaviour is fixed at compile time */
+   namespace execution = hwlocxx::experimental::execution;
+   auto blockingEx = mE.require(execution::blocking.always);
+   static_assert(!std::is_same_v<decltype(blockingEx), decltype(mE)>,
+                 "properties change the type of the executor");
+   auto done = blockingEx.twoway_execute([]() -> unsigned { return 1u; });
+   int properties =
+       (done.wait_for(std::chrono::seconds{0}) == std::future_status::ready)
+           ? 0
+           : 1;
+
+   // A continuation submitted from a worker stays on that worker
+   auto chained = mE.twoway_execute([&]() -> unsigned {
+      const auto pu = hwlocxx::experimental::this_thread::get_logical_pu();
+      return blockingEx.require(execution::relationship.continuation)
+                 .twoway_execute([pu]() -> unsigned {
+                    return hwlocxx::experimental::this_thread::get_logical_pu()
+                           == pu;
+                 })
+                 .get();
+   });
+   properties += 1 - static_cast<int>(chained.get());
+
+   // Elements of an unsequenced batch run a share at a time
+   std::atomic<unsigned> unseqCount{0u};
+   std::vector<std::function<void()>> unseq(100u, [&]() { unseqCount++; });
+   mE.require(execution::bulk_guarantee.unsequenced)
+       .prefer(execution::blocking.never)
+       .execute_batch(unseq)
+       .get();
+   properties += (unseqCount.load() == 100u) ? 0 : 1;
+
+   // Work placed near its data stays in the lane of the placement, on
+   // the reserved PUs
+   namespace this_thread = hwlocxx::experimental::this_thread;
+   auto urgentNear = mE.require(execution::placement.latency)
+                         .twoway_execute_near(v.data(), [&]() -> unsigned {
+                            auto pu = topo.get_object_by_type(
+                                HWLOC_OBJ_PU, this_thread::get_logical_pu());
+                            return reserved.is_set(pu.get_os_index());
+                         });
+   properties += 1 - static_cast<int>(urgentNear.get());
+
+   // Work in flight through a tracked executor holds wait() back
+   std::future<void> waiter;
+   {
+      auto tracked = mE.require(execution::outstanding_work.tracked);
+      auto copy = tracked;
+      waiter = std::async(std::launch::async, [&]() { hwEC.wait(); });
+      properties += (waiter.wait_for(std::chrono::milliseconds{10})
+                     == std::future_status::timeout)
+                        ? 0
+                        : 1;
+   }
+   waiter.get();
+
+   /* Check that the buffer is still where the allocator put it */
+   int audit = 0;
+   {
+      hwlocxx::experimental::locality_auditor auditor{
+          hwEC, std::chrono::milliseconds{100}};
+      auditor.watch("v", v.data(), v.size() * sizeof(unsigned),
+                    node.get_nodeset());
+      auditor.sample();
+      auto m = hwEC.metrics();
+      unsigned tasks = 0u;
+      for (const auto& w : m.workers) {
+         tasks += static_cast<unsigned>(w.tasks);
+      }
+      for (const auto& b : m.buffers) {
+         std::cout << " " << b.name << ": ";
+         if (b.local_fraction) {
+            std::cout << *b.local_fraction * 100 << "% local" << std::endl;
+         }
+         else {
+            std::cout << "no backed page" << std::endl;
+         }
+      }
+      audit += (m.buffers.size() == 1u && m.buffers[0].local_fraction == 1.0)
+                   ? 0
+                   : 1;
+      audit += (tasks >= nTasks) ? 0 : 1;
+      auditor.unwatch(v.data());
+      audit += hwEC.metrics().buffers.empty() ? 0 : 1;
+
+      // A buffer never touched is not reported as misplaced
+      const size_t untouchedLen = 1u << 16;
+      auto untouched = a.allocate(untouchedLen);
+      auditor.watch("untouched", untouched, untouchedLen * sizeof(unsigned),
+                    node.get_nodeset());
+      auditor.sample();
+      m = hwEC.metrics();
+      audit += (m.buffers.size() == 1u && !m.buffers[0].local_fraction
+                && m.buffers[0].unmapped == m.buffers[0].sampled)
+                   ? 0
+                   : 1;
+      auditor.unwatch(untouched);
+      a.deallocate(untouched, untouchedLen);
+   }
+
+   /* The process cpuset has not changed: nothing to refresh */
+   int refreshed = 0;
+   {
+      hwlocxx::experimental::cpuset_watcher watcher{
+          hwEC, std::chrono::milliseconds{1}};
+      refreshed = hwEC.refresh() ? 1 : 0;
+   }
+
+   /* Pinning the calling thread does not shrink the contexts it creates
+    * or refreshes
+    */
+   auto spread = [&](hwlocxx::experimental::ExecutionContext& eC) {
+      hwlocxx::bitmap used;
+      std::vector<std::future<unsigned>> where;
+      for (unsigned i = 0; i < 4 * eR.concurrency(); i++) {
+         where.push_back(eC.executor().twoway_execute([]() -> unsigned {
+            return static_cast<unsigned>(
+                hwlocxx::experimental::this_thread::get_logical_pu());
+         }));
+      }
+      for (auto& f : where) {
+         used.set(f.get());
+      }
+      return used.weight();
+   };
+   const auto binding = topo.get_cpubind(hwlocxx::cpubind::thread);
+   int unpinned = 0;
+   {
+      hwlocxx::experimental::ExecutionContext before{cList[0]};
+      unpinned = spread(before);
+   }
+   topo.set_cpubind(topo.get_object_by_type(HWLOC_OBJ_PU, 0).get_cpuset(),
+                    hwlocxx::cpubind::thread);
+   {
+      hwlocxx::experimental::ExecutionContext pinned{cList[0]};
+      refreshed += pinned.refresh() ? 1 : 0;
+      refreshed += (spread(pinned) == unpinned) ? 0 : 1;
+   }
+   topo.set_cpubind(binding, hwlocxx::cpubind::thread);
+
+   return (42 - fut.get()) + (7 - urgent.get()) + (10 - nearFut.get())
+          + (nTasks - puTotal) + (nTasks - nodeTotal)
+          + (100 - batchCount.load()) + refreshed + properties + audit;
 };
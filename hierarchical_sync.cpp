@@ -0,0 +1,65 @@
+/**
+  Copyright 2017 Ruyman Reyes
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  File: hierarchical_sync.cpp : Topology-shaped barrier and reduction
+
+*/
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// Include the Hwloc C++ wrapper
+#include <hwlocxx>
+
+int main()
+{
+   auto cList = hwlocxx::experimental::this_system::resources();
+
+   hwlocxx::experimental::hierarchical_barrier barrier{cList[0]};
+   hwlocxx::experimental::hierarchical_reduction<size_t> sum{cList[0]};
+
+   const size_t participants = barrier.size();
+   const size_t rounds = 100u;
+   std::atomic<size_t> arrived{0};
+   std::atomic<int> errors{0};
+
+   std::cout << "Participants: " << participants << std::endl;
+
+   std::vector<std::thread> threads;
+   for (size_t p = 0; p < participants; p++) {
+      threads.emplace_back([&, p]() {
+         for (size_t r = 0; r < rounds; r++) {
+            arrived++;
+            barrier.arrive_and_wait(p);
+            if (arrived.load() < participants * (r + 1)) {
+               errors++;
+            }
+
+            auto total = sum.reduce(p, p + r);
+            if (total != participants * (participants - 1) / 2
+                             + participants * r) {
+               errors++;
+            }
+         }
+      });
+   }
+
+   for (auto& t : threads) {
+      t.join();
+   }
+
+   return errors.load();
+}
@@ -16,6 +16,8 @@
 #ifndef HWLOCXX_ALLOCATOR_HPP
 #define HWLOCXX_ALLOCATOR_HPP
 
+#include <new>
+
 namespace hwlocxx
 {
 
@@ -54,14 +56,27 @@ class allocator
    const_pointer address(const_reference x) const { return &x; }
 
    /**
-    * Allocate size value_type elements
+    * Allocate size value_type elements.
+    * On topologies of other machines (see topology::is_thissystem()) hwloc
+    * gives back plain heap memory, so the memory comes from the aligned
+    * operator new instead to honour alignof(value_type). It is not
+    * registered with memory_regions either, as the nodes of such a
+    * topology are not those of this machine.
     */
    value_type* allocate(size_t size)
    {
-      value_type* result = nullptr;
-      result = static_cast<value_type*>(hwloc_alloc_membind(
+      if (!topo_.is_thissystem()) {
+         return static_cast<value_type*>(::operator new(
+             size * sizeof(value_type), std::align_val_t{alignof(value_type)},
+             std::nothrow));
+      }
+      auto result = static_cast<value_type*>(hwloc_alloc_membind(
           topo_.get(), size * sizeof(value_type), obj_.get()->nodeset,
           HWLOC_MEMBIND_BIND, HWLOC_MEMBIND_BYNODESET));
+      if (result) {
+         memory_regions::instance().insert(result, size * sizeof(value_type),
+                                           obj_.get_nodeset());
+      }
       return result;
    }
 
@@ -70,6 +85,11 @@ class allocator
     */
    void deallocate(value_type* ptr, size_t size)
    {
+      if (!topo_.is_thissystem()) {
+         ::operator delete(ptr, std::align_val_t{alignof(value_type)});
+         return;
+      }
+      memory_regions::instance().erase(ptr, size * sizeof(value_type));
       hwloc_free(topo_.get(), ptr, size * sizeof(value_type));
    }
 
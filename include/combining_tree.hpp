@@ -0,0 +1,258 @@
+/* Copyright 2017 Ruyman Reyes
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef HWLOCXX_COMBINING_TREE_HPP
+#define HWLOCXX_COMBINING_TREE_HPP
+
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace hwlocxx
+{
+namespace experimental
+{
+   namespace detail
+   {
+      /* Payload of a barrier: nothing to combine */
+      struct no_payload
+      {
+      };
+
+      struct no_op
+      {
+         no_payload operator()(no_payload, no_payload) const { return {}; }
+      };
+   } // namespace detail
+
+   /**
+    * Combining-tree reduction shaped like the hwloc tree below a resource.
+    *
+    * Participants are the PUs of the resource, numbered in topology order.
+    * Each level of the tree (SMT siblings, core, caches, package...) has a
+    * node sized to the number of children holding PUs, and levels with a
+    * single child are collapsed. Nodes are allocated on the NUMA nodes
+    * local to the object they represent, so arrivals only contend with
+    * their neighbours until the last one of a subtree moves up.
+    *
+    * T must be default constructible.
+    */
+   template <typename T, typename BinaryOp = std::plus<T>>
+   class hierarchical_reduction
+   {
+  public:
+      explicit hierarchical_reduction(const thread_execution_resource_t& eR,
+                                      BinaryOp op = BinaryOp{})
+          : hierarchical_reduction(eR.get_object(), op)
+      {
+      }
+
+      explicit hierarchical_reduction(hwlocxx::topology::object root,
+                                      BinaryOp op = BinaryOp{})
+          : topo_{*root.get_topo()}, op_{op}
+      {
+         auto pus = topo_.get_objects_inside(root.get_cpuset(), HWLOC_OBJ_PU);
+         firstPU_ = pus.empty() ? 0 : pus.front().get_logical_index();
+         build(root, nullptr, 0);
+      }
+
+      ~hierarchical_reduction()
+      {
+         for (auto& n : nodes_) {
+            allocator<detail::padded<T>> slotAlloc{topo_, n.obj};
+            for (unsigned i = 0; i < n.ptr->expected; i++) {
+               n.ptr->slots[i].~padded<T>();
+            }
+            slotAlloc.deallocate(n.ptr->slots, n.ptr->expected);
+            allocator<node> nodeAlloc{topo_, n.obj};
+            n.ptr->~node();
+            nodeAlloc.deallocate(n.ptr, 1);
+         }
+      }
+
+      hierarchical_reduction(const hierarchical_reduction&) = delete;
+      hierarchical_reduction& operator=(const hierarchical_reduction&) = delete;
+
+      /* Number of participants, i.e. PUs under the root */
+      size_t size() const { return leaves_.size(); }
+
+      /* Participant number of the given PU */
+      size_t participant(const hwlocxx::topology::object& pu) const
+      {
+         return pu.get_logical_index() - firstPU_;
+      }
+
+      /**
+       * Contributes value and blocks until all participants have arrived.
+       * Every participant receives the combination of all the values,
+       * combined in participant order.
+       */
+      T reduce(size_t participant, T value)
+      {
+         const auto& leaf = leaves_.at(participant);
+         arrive(leaf.parent, leaf.slot, std::move(value));
+         return result_;
+      }
+
+  private:
+      struct node
+      {
+         alignas(cache_line_size) std::atomic<unsigned> count{0};
+         alignas(cache_line_size) std::atomic<unsigned> generation{0};
+         unsigned expected;
+         node* parent;
+         unsigned slotInParent;
+         detail::padded<T>* slots;
+      };
+
+      struct owned_node
+      {
+         node* ptr;
+         hwlocxx::topology::object obj;
+      };
+
+      struct leaf
+      {
+         node* parent;
+         unsigned slot;
+      };
+
+      hwlocxx::topology topo_;
+      BinaryOp op_;
+      int firstPU_{0};
+      std::vector<owned_node> nodes_;
+      std::vector<leaf> leaves_;
+      T result_{};
+
+      void build(const hwlocxx::topology::object& o, node* parent,
+                 unsigned slot)
+      {
+         if (o.get()->type == HWLOC_OBJ_PU) {
+            leaves_.push_back({parent, slot});
+            return;
+         }
+
+         std::vector<hwlocxx::topology::object> children;
+         for (auto c : o.get_children()) {
+            if (!hwloc_bitmap_iszero(c.get()->cpuset)) {
+               children.push_back(c);
+            }
+         }
+
+         if (children.size() == 1) {
+            build(children.front(), parent, slot);
+            return;
+         }
+
+         auto* n = make_node(o, children.size(), parent, slot);
+         for (unsigned i = 0; i < children.size(); i++) {
+            build(children[i], n, i);
+         }
+      }
+
+      node* make_node(const hwlocxx::topology::object& o, size_t arity,
+                      node* parent, unsigned slot)
+      {
+         allocator<node> nodeAlloc{topo_, o};
+         allocator<detail::padded<T>> slotAlloc{topo_, o};
+         auto* n = nodeAlloc.allocate(1);
+         auto* slots = slotAlloc.allocate(arity);
+         if (!n || !slots) {
+            throw std::bad_alloc{};
+         }
+         for (size_t i = 0; i < arity; i++) {
+            ::new (&slots[i]) detail::padded<T>{};
+         }
+         ::new (n) node{};
+         n->expected = static_cast<unsigned>(arity);
+         n->parent = parent;
+         n->slotInParent = slot;
+         n->slots = slots;
+         nodes_.push_back({n, o});
+         return n;
+      }
+
+      void arrive(node* n, unsigned slot, T value)
+      {
+         if (!n) {
+            result_ = std::move(value);
+            return;
+         }
+
+         n->slots[slot].value = std::move(value);
+         const auto gen = n->generation.load(std::memory_order_acquire);
+         if (n->count.fetch_add(1, std::memory_order_acq_rel) + 1
+             == n->expected) {
+            // Last one in this subtree: combine and move up
+            T acc = n->slots[0].value;
+            for (unsigned i = 1; i < n->expected; i++) {
+               acc = op_(std::move(acc), n->slots[i].value);
+            }
+            n->count.store(0, std::memory_order_relaxed);
+            arrive(n->parent, n->slotInParent, std::move(acc));
+            n->generation.fetch_add(1, std::memory_order_release);
+         }
+         else {
+            for (unsigned spin = 0;
+                 n->generation.load(std::memory_order_acquire) == gen;
+                 spin++) {
+               if (spin < 64) {
+                  detail::cpu_relax();
+               }
+               else {
+                  std::this_thread::yield();
+               }
+            }
+         }
+      }
+   };
+
+   /**
+    * Barrier over the PUs of a resource, using the same topology-shaped
+    * combining tree as hierarchical_reduction.
+    */
+   class hierarchical_barrier
+   {
+  public:
+      explicit hierarchical_barrier(const thread_execution_resource_t& eR)
+          : tree_{eR}
+      {
+      }
+
+      explicit hierarchical_barrier(hwlocxx::topology::object root)
+          : tree_{root}
+      {
+      }
+
+      size_t size() const { return tree_.size(); }
+
+      size_t participant(const hwlocxx::topology::object& pu) const
+      {
+         return tree_.participant(pu);
+      }
+
+      void arrive_and_wait(size_t participant)
+      {
+         tree_.reduce(participant, {});
+      }
+
+  private:
+      hierarchical_reduction<detail::no_payload, detail::no_op> tree_;
+   };
+
+} // namespace experimental
+} // namespace hwlocxx
+#endif // HWLOCXX_COMBINING_TREE_HPP
@@ -0,0 +1,272 @@
+/* Copyright 2017 Ruyman Reyes
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef HWLOCXX_DISTANCES_HPP
+#define HWLOCXX_DISTANCES_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace hwlocxx
+{
+
+/**
+ * Dense matrix of the distances between the NUMA nodes of a topology,
+ * read once from the matrices hwloc knows about (ACPI SLIT/HMAT, XML,
+ * user-provided).
+ *
+ * Rows and columns are NUMA node logical indexes, and row i holds the
+ * distances from node i, and a 0 distance means unknown: hwloc matrices
+ * may only cover some of the nodes. Latency matrices missing from hwloc
+ * are derived from the tree like a SLIT table: 10 within a node, and
+ * 10 more for each level up to the closest common ancestor of two nodes
+ * (at least one). Missing bandwidth matrices are left empty.
+ */
+class distance_matrix
+{
+   public:
+   enum class kind
+   {
+      latency,
+      bandwidth
+   };
+
+   distance_matrix(const topology& topo, kind k) : kind_{k}
+   {
+      const int numNodes = topo.get_width_by_type(HWLOC_OBJ_NUMANODE);
+      size_ = numNodes > 0 ? static_cast<size_t>(numNodes) : 0u;
+      for (size_t i = 0; i < size_; i++) {
+         auto node = topo.get_object_by_type(HWLOC_OBJ_NUMANODE,
+                                             static_cast<int>(i));
+         const auto os = static_cast<size_t>(node.get_os_index());
+         if (osToLogical_.size() <= os) {
+            osToLogical_.resize(os + 1, -1);
+         }
+         osToLogical_[os] = static_cast<int>(i);
+      }
+
+      measured_ = read(topo);
+      if (!measured_ && k == kind::latency) {
+         derive(topo);
+      }
+   }
+
+   /* Number of NUMA nodes, or 0 if nothing is known about this kind */
+   size_t size() const { return values_.empty() ? 0u : size_; }
+   bool empty() const { return values_.empty(); }
+
+   kind get_kind() const { return kind_; }
+
+   /* Whether the values come from hwloc rather than from the tree */
+   bool measured() const { return measured_; }
+
+   /* Distance from node from to node to, by logical index, 0 if unknown */
+   std::uint64_t operator()(size_t from, size_t to) const
+   {
+      return values_[from * size_ + to];
+   }
+
+   /* Logical index of the NUMA node with the given OS index, or -1 */
+   int logical_index(int os) const
+   {
+      return (os >= 0 && static_cast<size_t>(os) < osToLogical_.size())
+                 ? osToLogical_[os]
+                 : -1;
+   }
+
+   private:
+   /* Copies the first hwloc matrix of the right kind. Nodes it does not
+    * cover keep a 0 (unknown) distance to the others, as values derived
+    * from the tree would not be in the same unit.
+    */
+   bool read(const topology& topo)
+   {
+      const unsigned long flag = (kind_ == kind::latency)
+                                     ? HWLOC_DISTANCES_KIND_MEANS_LATENCY
+                                     : HWLOC_DISTANCES_KIND_MEANS_BANDWIDTH;
+      unsigned nr = 1;
+      hwloc_distances_s* dist = nullptr;
+      if (hwloc_distances_get_by_type(topo.get(), HWLOC_OBJ_NUMANODE, &nr,
+                                      &dist, flag, 0)
+              < 0
+          || nr == 0) {
+         return false;
+      }
+
+      values_.assign(size_ * size_, 0u);
+      for (unsigned i = 0; i < dist->nbobjs; i++) {
+         for (unsigned j = 0; j < dist->nbobjs; j++) {
+            values_[dist->objs[i]->logical_index * size_
+                    + dist->objs[j]->logical_index] =
+                dist->values[i * dist->nbobjs + j];
+         }
+      }
+      hwloc_distances_release(topo.get(), dist);
+      return true;
+   }
+
+   void derive(const topology& topo)
+   {
+      values_.assign(size_ * size_, 0u);
+      for (size_t i = 0; i < size_; i++) {
+         auto a = topo.get_object_by_type(HWLOC_OBJ_NUMANODE,
+                                          static_cast<int>(i))
+                      .get();
+         for (size_t j = 0; j < size_; j++) {
+            auto b = topo.get_object_by_type(HWLOC_OBJ_NUMANODE,
+                                             static_cast<int>(j))
+                         .get();
+            // NUMA nodes hang off the normal object they are local to
+            auto common =
+                hwloc_get_common_ancestor_obj(topo.get(), a->parent, b->parent);
+            const auto levels =
+                std::max({a->parent->depth - common->depth,
+                          b->parent->depth - common->depth, 1});
+            const auto hops =
+                (i == j) ? 0u : static_cast<std::uint64_t>(levels);
+            values_[i * size_ + j] = 10u + 10u * hops;
+         }
+      }
+   }
+
+   kind kind_;
+   size_t size_{0};
+   bool measured_{false};
+   std::vector<std::uint64_t> values_;
+   std::vector<int> osToLogical_;
+};
+
+namespace experimental
+{
+   /**
+    * Expected cost of remote memory accesses for a placement of work and
+    * data over the NUMA nodes of a topology.
+    *
+    * Costs are latencies relative to a local access, so work running next
+    * to its data costs its weight, and the same work a socket away costs
+    * its weight times the latency ratio.
+    */
+   class placement_cost
+   {
+  public:
+      /* Work running on cpuset, accessing memory bound to nodeset */
+      struct assignment
+      {
+         bitmap cpuset;
+         bitmap nodeset;
+         double weight;
+      };
+
+      explicit placement_cost(const topology& topo)
+          : topo_{&topo},
+            latency_{topo, distance_matrix::kind::latency},
+            bandwidth_{topo, distance_matrix::kind::bandwidth}
+      {
+      }
+
+      const distance_matrix& latency() const { return latency_; }
+
+      /* Empty unless hwloc knows the bandwidths between the nodes */
+      const distance_matrix& bandwidth() const { return bandwidth_; }
+
+      /**
+       * Relative cost of an access from the NUMA nodes of cpuset to the
+       * memory on nodeset, averaged over both sets. Local accesses cost 1,
+       * unknown locations too.
+       */
+      double score(const bitmap& cpuset, const bitmap& nodeset) const
+      {
+         auto from = nodes_of(cpuset);
+         double total = 0.0;
+         size_t count = 0;
+         for (int f : from) {
+            const int i = latency_.logical_index(f);
+            for (int t : nodeset) {
+               const int j = latency_.logical_index(t);
+               if (i < 0 || j < 0 || latency_(i, i) == 0
+                   || latency_(i, j) == 0) {
+                  continue;
+               }
+               total += static_cast<double>(latency_(i, j)) / latency_(i, i);
+               count++;
+            }
+         }
+         return count ? total / count : 1.0;
+      }
+
+      /* Weighted cost of a whole placement */
+      double score(const std::vector<assignment>& placement) const
+      {
+         double total = 0.0;
+         for (const auto& a : placement) {
+            total += a.weight * score(a.cpuset, a.nodeset);
+         }
+         return total;
+      }
+
+      /**
+       * OS index of the node of candidates (a nodeset) with the lowest
+       * average latency to the memory on nodeset, or -1 if candidates is
+       * empty. Unknown latencies are skipped, and candidates without any
+       * known latency only come before the others when all are unknown.
+       */
+      int closest(const bitmap& nodeset, const bitmap& candidates) const
+      {
+         int best = candidates.first();
+         auto bestCost = std::numeric_limits<double>::max();
+         for (int c : candidates) {
+            const int i = latency_.logical_index(c);
+            double cost = 0.0;
+            size_t count = 0;
+            for (int n : nodeset) {
+               const int j = latency_.logical_index(n);
+               if (i >= 0 && j >= 0 && latency_(i, j) != 0) {
+                  cost += static_cast<double>(latency_(i, j));
+                  count++;
+               }
+            }
+            if (count == 0) {
+               continue;
+            }
+            cost /= count;
+            if (cost < bestCost) {
+               best = c;
+               bestCost = cost;
+            }
+         }
+         return best;
+      }
+
+  private:
+      /* NUMA nodes local to the PUs of cpuset */
+      bitmap nodes_of(const bitmap& cpuset) const
+      {
+         bitmap nodes;
+         for (auto& pu : topo_->get_objects_inside(cpuset, HWLOC_OBJ_PU)) {
+            nodes |= pu.get_nodeset();
+         }
+         return nodes;
+      }
+
+      const topology* topo_;
+      distance_matrix latency_;
+      distance_matrix bandwidth_;
+   };
+} // namespace experimental
+
+} // namespace hwlocxx
+#endif // HWLOCXX_DISTANCES_HPP
@@ -0,0 +1,175 @@
+/* Copyright 2017 Ruyman Reyes
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef HWLOCXX_EXECUTION_PROPERTIES_HPP
+#define HWLOCXX_EXECUTION_PROPERTIES_HPP
+
+#include <type_traits>
+
+namespace hwlocxx
+{
+namespace experimental
+{
+   /**
+    * Executor properties, after P0443.
+    *
+    * Every value of a property is its own type. Requiring or preferring
+    * one gives back an executor of another type, so the behaviour is
+    * picked at compile time and submission does not test any flag.
+    */
+   namespace execution
+   {
+      struct blocking_t
+      {
+         /* Submission returns without waiting for the work */
+         struct never_t
+         {
+            using property_type = blocking_t;
+         };
+         /* Submission may wait for the work */
+         struct possibly_t
+         {
+            using property_type = blocking_t;
+         };
+         /* Submission returns once the work has run */
+         struct always_t
+         {
+            using property_type = blocking_t;
+         };
+
+         static constexpr never_t never{};
+         static constexpr possibly_t possibly{};
+         static constexpr always_t always{};
+      };
+
+      struct relationship_t
+      {
+         /* The work is independent from the submitter */
+         struct fork_t
+         {
+            using property_type = relationship_t;
+         };
+         /* The work continues the task submitting it, and runs on the
+          * same worker after it when submitted from a worker.
+          */
+         struct continuation_t
+         {
+            using property_type = relationship_t;
+         };
+
+         static constexpr fork_t fork{};
+         static constexpr continuation_t continuation{};
+      };
+
+      struct outstanding_work_t
+      {
+         struct untracked_t
+         {
+            using property_type = outstanding_work_t;
+         };
+         /* The executor counts as outstanding work of its context for
+          * as long as it exists, see ExecutionContext::wait().
+          */
+         struct tracked_t
+         {
+            using property_type = outstanding_work_t;
+         };
+
+         static constexpr untracked_t untracked{};
+         static constexpr tracked_t tracked{};
+      };
+
+      struct bulk_guarantee_t
+      {
+         /* All the elements run in order, on a single worker */
+         struct sequenced_t
+         {
+            using property_type = bulk_guarantee_t;
+         };
+         /* Elements may run concurrently and may throw */
+         struct parallel_t
+         {
+            using property_type = bulk_guarantee_t;
+         };
+         /* Elements may run concurrently and interleaved, and must not
+          * throw. Each share of the batch runs as a single task.
+          */
+         struct unsequenced_t
+         {
+            using property_type = bulk_guarantee_t;
+         };
+
+         static constexpr sequenced_t sequenced{};
+         static constexpr parallel_t parallel{};
+         static constexpr unsequenced_t unsequenced{};
+      };
+
+      struct placement_t
+      {
+         /* Batch lane, workers in turn */
+         struct round_robin_t
+         {
+            using property_type = placement_t;
+         };
+         /* Latency lane, on the reserved PUs if any */
+         struct latency_t
+         {
+            using property_type = placement_t;
+         };
+
+         static constexpr round_robin_t round_robin{};
+         static constexpr latency_t latency{};
+      };
+
+      inline constexpr blocking_t blocking{};
+      inline constexpr relationship_t relationship{};
+      inline constexpr outstanding_work_t outstanding_work{};
+      inline constexpr bulk_guarantee_t bulk_guarantee{};
+      inline constexpr placement_t placement{};
+
+      namespace detail
+      {
+         template <typename T, typename = void>
+         struct property_of
+         {
+            using type = void;
+         };
+
+         template <typename T>
+         struct property_of<T, std::void_t<typename T::property_type>>
+         {
+            using type = typename T::property_type;
+         };
+
+         template <typename T>
+         using property_of_t = typename property_of<std::decay_t<T>>::type;
+
+         template <typename T>
+         inline constexpr bool is_one_of_v =
+             std::is_same_v<T, blocking_t> || std::is_same_v<T, relationship_t>
+             || std::is_same_v<T, outstanding_work_t>
+             || std::is_same_v<T, bulk_guarantee_t>
+             || std::is_same_v<T, placement_t>;
+      } // namespace detail
+
+      /* Whether T is a value of one of the properties above */
+      template <typename T>
+      inline constexpr bool is_property_value_v =
+          detail::is_one_of_v<detail::property_of_t<T>>;
+   } // namespace execution
+
+} // namespace experimental
+} // namespace hwlocxx
+#endif // HWLOCXX_EXECUTION_PROPERTIES_HPP
@@ -18,19 +18,23 @@
 
 */
 
+#include <algorithm>
+#include <array>
 #include <cerrno>
+#include <cstdint>
 #include <gsl/gsl>
+#include <iterator>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <vector>
 
 #include <hwloc.h>
 
-/**
- * Alias to the internal hwloc bitmap structure
- */
-using __bitMaskStruct = struct hwloc_bitmap_s;
-
 namespace hwlocxx
 {
 
@@ -41,19 +45,39 @@ enum class cpubind
 };
 
 /**
- * Contains a pointer to a hwloc bitmap structure
+ * Set of PU or NUMA node indexes with value semantics.
+ *
+ * Indexes below inline_bits are stored inline, so copies and temporaries
+ * do not allocate. Setting a larger index moves the storage to the heap.
+ * Set operations work a word at a time over contiguous storage, so the
+ * compiler can vectorise them. Conversion to hwloc bitmaps only happens
+ * at hwloc API calls, through per-thread scratch bitmaps.
  */
 class bitmap
 {
    public:
-   bitmap() : bMap_{nullptr}
+   using word_type = std::uint64_t;
+   static constexpr size_t word_bits = 64;
+   static constexpr size_t inline_bits = 1024;
+   static constexpr size_t inline_words = inline_bits / word_bits;
+
+   static_assert(sizeof(unsigned long) == sizeof(word_type),
+                 "hwloc ulong conversions assume 64-bit unsigned long");
+
+   bitmap() = default;
+
+   /* Copy of a hwloc bitmap. Infinite bitmaps are truncated to
+    * inline_bits. */
+   explicit bitmap(hwloc_const_bitmap_t src)
    {
-      hwloc_bitmap_t ptr = hwloc_bitmap_alloc();
-      bMap_ = std::shared_ptr<__bitMaskStruct>{ptr, bitmapDeleter()};
+      int nr = hwloc_bitmap_nr_ulongs(src);
+      size_t n = (nr < 0) ? inline_words : static_cast<size_t>(nr);
+      reserve_words(n);
+      for (size_t i = 0; i < n; i++) {
+         words()[i] = hwloc_bitmap_to_ith_ulong(src, static_cast<unsigned>(i));
+      }
    }
 
-   explicit bitmap(hwloc_bitmap_t ptr) : bMap_{ptr, bitmapDeleter()} {}
-
    ~bitmap() = default;
 
    bitmap(const bitmap&) = default;
@@ -61,43 +85,355 @@ class bitmap
    bitmap& operator=(const bitmap& bMap) = default;
    bitmap& operator=(bitmap&& bMap) = default;
 
-   /* Modifying and not */
-   bitmap and_not(const bitmap& rhs)
+   void set(unsigned i)
    {
-      hwloc_bitmap_andnot(bMap_.get(), bMap_.get(), rhs.get());
-      return *this;
+      reserve_words(i / word_bits + 1);
+      words()[i / word_bits] |= word_type{1} << (i % word_bits);
+   }
+
+   void clear(unsigned i)
+   {
+      if (i / word_bits < nwords()) {
+         words()[i / word_bits] &= ~(word_type{1} << (i % word_bits));
+      }
+   }
+
+   bool is_set(unsigned i) const
+   {
+      return (word(i / word_bits) >> (i % word_bits)) & 1u;
    }
 
+   bool empty() const
+   {
+      word_type acc = 0;
+      for (size_t i = 0; i < nwords(); i++) {
+         acc |= words()[i];
+      }
+      return acc == 0;
+   }
+
+   /* Number of indexes set */
+   int weight() const
+   {
+      int count = 0;
+      for (size_t i = 0; i < nwords(); i++) {
+         count += __builtin_popcountll(words()[i]);
+      }
+      return count;
+   }
+
+   int first() const { return next(-1); }
+
+   /* Next index set after prev, or -1 if there is none */
+   int next(int prev) const
+   {
+      size_t i = static_cast<size_t>(prev + 1);
+      size_t w = i / word_bits;
+      if (w >= nwords()) {
+         return -1;
+      }
+      word_type bits = words()[w] & (~word_type{0} << (i % word_bits));
+      while (bits == 0) {
+         if (++w == nwords()) {
+            return -1;
+         }
+         bits = words()[w];
+      }
+      return static_cast<int>(w * word_bits + __builtin_ctzll(bits));
+   }
+
+   /* Indexes set in this bitmap but not in rhs */
    bitmap and_not(const bitmap& rhs) const
    {
-      bitmap ret;
-      hwloc_bitmap_andnot(ret.get(), bMap_.get(), rhs.get());
+      bitmap ret{*this};
+      const size_t n = std::min(ret.nwords(), rhs.nwords());
+      for (size_t i = 0; i < n; i++) {
+         ret.words()[i] &= ~rhs.words()[i];
+      }
       return ret;
    }
 
-   int first() const { return hwloc_bitmap_first(get()); }
+   bitmap& operator&=(const bitmap& rhs)
+   {
+      for (size_t i = 0; i < nwords(); i++) {
+         words()[i] &= rhs.word(i);
+      }
+      return *this;
+   }
+
+   bitmap& operator|=(const bitmap& rhs)
+   {
+      reserve_words(rhs.nwords());
+      for (size_t i = 0; i < rhs.nwords(); i++) {
+         words()[i] |= rhs.words()[i];
+      }
+      return *this;
+   }
+
+   friend bitmap operator&(bitmap lhs, const bitmap& rhs) { return lhs &= rhs; }
+
+   friend bitmap operator|(bitmap lhs, const bitmap& rhs) { return lhs |= rhs; }
+
+   friend bool operator==(const bitmap& lhs, const bitmap& rhs)
+   {
+      const size_t n = std::max(lhs.nwords(), rhs.nwords());
+      word_type diff = 0;
+      for (size_t i = 0; i < n; i++) {
+         diff |= lhs.word(i) ^ rhs.word(i);
+      }
+      return diff == 0;
+   }
+
+   friend bool operator!=(const bitmap& lhs, const bitmap& rhs)
+   {
+      return !(lhs == rhs);
+   }
+
+   /**
+    * Forward iteration over the indexes set
+    */
+   class const_iterator
+   {
+  public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = int;
+      using difference_type = std::ptrdiff_t;
+      using pointer = const int*;
+      using reference = int;
+
+      const_iterator(const bitmap* b, int i) : b_{b}, i_{i} {}
+
+      int operator*() const { return i_; }
+
+      const_iterator& operator++()
+      {
+         i_ = b_->next(i_);
+         return *this;
+      }
+
+      const_iterator operator++(int)
+      {
+         auto ret = *this;
+         ++(*this);
+         return ret;
+      }
+
+      bool operator==(const const_iterator& rhs) const { return i_ == rhs.i_; }
+      bool operator!=(const const_iterator& rhs) const { return i_ != rhs.i_; }
+
+  private:
+      const bitmap* b_;
+      int i_;
+   };
+
+   const_iterator begin() const { return {this, first()}; }
+   const_iterator end() const { return {this, -1}; }
+
+   /* Per-thread hwloc bitmaps used to exchange sets with hwloc */
+   enum class scratch_slot : unsigned
+   {
+      // Sets passed to hwloc, see as_hwloc()
+      input,
+      // Sets filled in by hwloc
+      output
+   };
+
+   /**
+    * Copies the set into the per-thread input bitmap, to be passed to
+    * hwloc calls. It stays valid until the next as_hwloc() on the
+    * calling thread, so a call can only take one such set; results of
+    * hwloc go to the output bitmap and never overwrite it.
+    */
+   hwloc_const_bitmap_t as_hwloc() const
+   {
+      auto out = scratch(scratch_slot::input);
+      hwloc_bitmap_from_ulongs(
+          out, static_cast<unsigned>(nwords()),
+          reinterpret_cast<const unsigned long*>(words()));
+      return out;
+   }
 
-   hwloc_bitmap_t get() const { return bMap_.get(); }
+   static hwloc_bitmap_t scratch(scratch_slot slot)
+   {
+      struct scratch_set
+      {
+         scratch_set()
+         {
+            for (auto& s : sets) {
+               s = hwloc_bitmap_alloc();
+            }
+         }
+         ~scratch_set()
+         {
+            for (auto& s : sets) {
+               hwloc_bitmap_free(s);
+            }
+         }
+         std::array<hwloc_bitmap_t, 2> sets;
+      };
+      static thread_local scratch_set scratchSet;
+      return scratchSet.sets[static_cast<unsigned>(slot)];
+   }
 
    friend std::ostream& operator<<(std::ostream& stream, const bitmap& rhs)
    {
       char str[128];
-      hwloc_bitmap_snprintf(str, 128, rhs.get());
+      hwloc_bitmap_snprintf(str, 128, rhs.as_hwloc());
       stream << str << std::endl;
       return stream;
    }
 
    private:
-   std::shared_ptr<__bitMaskStruct> bMap_;
+   std::array<word_type, inline_words> inline_{};
+   // Storage once an index beyond inline_bits has been set
+   std::vector<word_type> heap_;
 
-   /**
-    * Custom deleters that guarantees bitmap is freed using the
-    * correct hwloc functionality
+   size_t nwords() const { return heap_.empty() ? inline_words : heap_.size(); }
+
+   word_type* words() { return heap_.empty() ? inline_.data() : heap_.data(); }
+
+   const word_type* words() const
+   {
+      return heap_.empty() ? inline_.data() : heap_.data();
+   }
+
+   word_type word(size_t i) const { return (i < nwords()) ? words()[i] : 0; }
+
+   void reserve_words(size_t n)
+   {
+      if (n <= nwords()) {
+         return;
+      }
+      if (heap_.empty()) {
+         heap_.assign(inline_.begin(), inline_.end());
+      }
+      heap_.resize(n, 0);
+   }
+};
+
+class topology;
+
+namespace detail
+{
+   /* Object following current in a traversal from root, or the first one
+    * if current is null. Returns null at the end of the traversal.
     */
-   struct bitmapDeleter
+   using object_step = hwloc_obj_t (*)(hwloc_topology_t topo, hwloc_obj_t root,
+                                       hwloc_obj_t current);
+
+   inline hwloc_obj_t next_child(hwloc_topology_t, hwloc_obj_t root,
+                                 hwloc_obj_t current)
+   {
+      return current ? current->next_sibling : root->first_child;
+   }
+
+   inline hwloc_obj_t next_ancestor(hwloc_topology_t, hwloc_obj_t root,
+                                    hwloc_obj_t current)
+   {
+      return current ? current->parent : root->parent;
+   }
+
+   inline hwloc_obj_t next_cousin(hwloc_topology_t topo, hwloc_obj_t root,
+                                  hwloc_obj_t current)
+   {
+      return current ? current->next_cousin
+                     : hwloc_get_obj_by_depth(topo, root->depth, 0);
+   }
+
+   inline hwloc_obj_t next_pu(hwloc_topology_t topo, hwloc_obj_t root,
+                              hwloc_obj_t current)
    {
-      void operator()(hwloc_bitmap_t ptr) { hwloc_bitmap_free(ptr); }
+      return hwloc_get_next_obj_inside_cpuset_by_type(topo, root->cpuset,
+                                                      HWLOC_OBJ_PU, current);
+   }
+} // namespace detail
+
+/**
+ * Lazy range over objects of a topology. Iterating follows the links
+ * between hwloc objects in place and never allocates; each element is
+ * built as a Value (a topology::object, or anything constructible from
+ * one) when dereferenced.
+ */
+template <typename Value>
+class object_view
+{
+   public:
+   class iterator
+   {
+  public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = Value;
+      using difference_type = std::ptrdiff_t;
+      using pointer = void;
+      using reference = Value;
+
+      iterator() = default;
+
+      iterator(const topology* topo, hwloc_topology_t hwTopo, hwloc_obj_t root,
+               hwloc_obj_t current, detail::object_step step)
+          : topo_{topo}, hwTopo_{hwTopo}, root_{root}, current_{current},
+            step_{step}
+      {
+      }
+
+      Value operator*() const;
+
+      iterator& operator++()
+      {
+         current_ = step_(hwTopo_, root_, current_);
+         return *this;
+      }
+
+      iterator operator++(int)
+      {
+         auto ret = *this;
+         ++(*this);
+         return ret;
+      }
+
+      bool operator==(const iterator& rhs) const
+      {
+         return current_ == rhs.current_;
+      }
+
+      bool operator!=(const iterator& rhs) const
+      {
+         return current_ != rhs.current_;
+      }
+
+  private:
+      const topology* topo_{nullptr};
+      hwloc_topology_t hwTopo_{nullptr};
+      hwloc_obj_t root_{nullptr};
+      hwloc_obj_t current_{nullptr};
+      detail::object_step step_{nullptr};
    };
+
+   object_view(const topology* topo, hwloc_topology_t hwTopo, hwloc_obj_t root,
+               detail::object_step step)
+       : topo_{topo}, hwTopo_{hwTopo}, root_{root}, step_{step},
+         first_{root ? step(hwTopo, root, nullptr) : nullptr}
+   {
+   }
+
+   iterator begin() const { return {topo_, hwTopo_, root_, first_, step_}; }
+   iterator end() const { return {topo_, hwTopo_, root_, nullptr, step_}; }
+
+   bool empty() const { return first_ == nullptr; }
+
+   /* Same traversal, yielding another type of element */
+   template <typename Other>
+   object_view<Other> as() const
+   {
+      return {topo_, hwTopo_, root_, step_};
+   }
+
+   private:
+   const topology* topo_;
+   hwloc_topology_t hwTopo_;
+   hwloc_obj_t root_;
+   detail::object_step step_;
+   hwloc_obj_t first_;
 };
 
 /**
@@ -169,11 +505,61 @@ class topology
          return retVal;
       }
 
+      /* Children of this object, in logical order */
+      object_view<object> get_children() const
+      {
+         return {topo_, topo_->get(), obj_.get(), &detail::next_child};
+      }
+
+      /* PUs below this object, in logical order */
+      object_view<object> get_pus() const
+      {
+         return {topo_, topo_->get(), obj_.get(), &detail::next_pu};
+      }
+
+      /* Parent of this object, then its parent, up to the root */
+      object_view<object> get_ancestors() const
+      {
+         return {topo_, topo_->get(), obj_.get(), &detail::next_ancestor};
+      }
+
+      /* Objects at the depth of this one, itself included */
+      object_view<object> get_cousins() const
+      {
+         return {topo_, topo_->get(), obj_.get(), &detail::next_cousin};
+      }
+
+      /* Name of the type of the object, e.g. "Core". Not allocated. */
+      std::string_view get_type_name() const
+      {
+         return hwloc_obj_type_string(obj_.get()->type);
+      }
+
       int get_logical_index() const { return obj_.get()->logical_index; }
 
+      int get_os_index() const { return obj_.get()->os_index; }
+
+      /* Copy of the set of PUs covered by this object */
+      bitmap get_cpuset() const { return bitmap{obj_.get()->cpuset}; }
+
+      /* Copy of the set of NUMA nodes local to this object */
+      bitmap get_nodeset() const { return bitmap{obj_.get()->nodeset}; }
+
+      /* Closest ancestor that is not an I/O object (the object itself if
+       * it is not one), i.e. where the PUs and memory local to a device
+       * hang off.
+       */
+      object get_non_io_ancestor() const
+      {
+         return {topo_,
+                 hwloc_get_non_io_ancestor_obj(topo_->get(), obj_.get())};
+      }
+
+      /* Objects of the same type, closest first in tree order */
       std::vector<object> get_closest() const
       {
-         const size_t maxObjects = 10u;
+         const auto width = topo_->get_width_at_depth(obj_.get()->depth);
+         const unsigned maxObjects = width > 1 ? width - 1 : 1u;
          std::vector<hwloc_obj_t> hwObjs(maxObjects);
          unsigned numElems = hwloc_get_closest_objs(topo_->get(), obj_.get(),
                                                     hwObjs.data(), maxObjects);
@@ -199,16 +585,71 @@ class topology
       gsl::not_null<const topology*> topo_;
    };
 
-   topology() : topology_{nullptr}
+   /* Synthetic description of a machine, e.g.
+    * "pack:8 numa:2 l3:1 core:16 pu:2"
+    */
+   struct synthetic
    {
-      hwloc_topology_t system = nullptr;
-      hwloc_topology_init(&system);
-      topology_ = std::shared_ptr<hwloc_topology>{
-          system, [=](hwloc_topology_t ptr) { hwloc_topology_destroy(ptr); }};
-      hwloc_topology_load(topology_.get());
+      std::string description;
+   };
+
+   /* Path to an XML export of a topology, e.g. from lstopo
+    */
+   struct xml
+   {
+      std::string path;
+   };
+
+   /* Kinds of objects kept when loading a topology. By default, as in
+    * hwloc, I/O objects and instruction caches are left out.
+    */
+   struct filters
+   {
+      // PCI bridges, PCI devices and OS devices (e.g. eth0, nvme0n1)
+      hwloc_type_filter_e io = HWLOC_TYPE_FILTER_KEEP_NONE;
+      hwloc_type_filter_e icaches = HWLOC_TYPE_FILTER_KEEP_NONE;
+
+      /* Keeps the devices and bridges needed to locate OS devices */
+      static filters with_io()
+      {
+         filters f;
+         f.io = HWLOC_TYPE_FILTER_KEEP_IMPORTANT;
+         return f;
+      }
+   };
+
+   topology() : topology(filters{}) {}
+
+   /* Topology of a machine that is not the current one. Binding calls
+    * on it are stubbed, see is_thissystem().
+    */
+   explicit topology(const synthetic& desc) : topology(desc, filters{}) {}
+
+   explicit topology(const xml& file) : topology(file, filters{}) {}
+
+   explicit topology(const filters& f) : topology_{nullptr}
+   {
+      load([](hwloc_topology_t) { return 0; }, f);
+   }
+
+   topology(const synthetic& desc, const filters& f) : topology_{nullptr}
+   {
+      load(
+          [&desc](hwloc_topology_t system) {
+             return hwloc_topology_set_synthetic(system,
+                                                 desc.description.c_str());
+          },
+          f);
    }
 
-   /* @todo Constructors that takes filters for elements of the topology */
+   topology(const xml& file, const filters& f) : topology_{nullptr}
+   {
+      load(
+          [&file](hwloc_topology_t system) {
+             return hwloc_topology_set_xml(system, file.path.c_str());
+          },
+          f);
+   }
 
    ~topology() = default;
 
@@ -221,6 +662,16 @@ class topology
 
    hwloc_topology_t get() const { return topology_.get(); }
 
+   /* Whether the topology describes the machine we are running on.
+    * If not (synthetic or XML topologies), binding calls only record
+    * the binding of the calling thread, or of the whole process, so
+    * placement logic can run unchanged.
+    */
+   bool is_thissystem() const
+   {
+      return hwloc_topology_is_thissystem(get()) != 0;
+   }
+
    object get_obj(int depth, int elem) const { return {this, depth, elem}; }
 
    int get_width_at_depth(int depth) const
@@ -243,6 +694,13 @@ class topology
       return {this, i};
    }
 
+   /* Objects at the given depth, in logical order, without allocating */
+   object_view<object> get_level(int depth) const
+   {
+      return {this, get(), hwloc_get_obj_by_depth(get(), depth, 0),
+              &detail::next_cousin};
+   }
+
    std::vector<object> get_objects(int lvl) const
    {
       const int maxObjects = get_width_at_depth(lvl);
@@ -256,39 +714,178 @@ class topology
       return retObjs;
    }
 
+   /* Objects of the given type whose cpuset is included in set,
+    * in logical (topology) order.
+    */
+   std::vector<object> get_objects_inside(const bitmap& set,
+                                          hwloc_obj_type_t type) const
+   {
+      std::vector<object> retObjs;
+      auto hwSet = set.as_hwloc();
+      hwloc_obj_t o = nullptr;
+      while ((o = hwloc_get_next_obj_inside_cpuset_by_type(get(), hwSet, type,
+                                                           o))) {
+         retObjs.emplace_back(this, o);
+      }
+      return retObjs;
+   }
+
+   /* OS device with the given name, e.g. "eth0" or "nvme0n1". Only found
+    * if the topology was loaded with I/O objects, see filters.
+    */
+   std::optional<object> get_os_device(const std::string& name) const
+   {
+      hwloc_obj_t o = nullptr;
+      while ((o = hwloc_get_next_osdev(get(), o))) {
+         if (o->name && name == o->name) {
+            return object{this, o};
+         }
+      }
+      return std::nullopt;
+   }
+
+   /* Returns the set of NUMA nodes where the pages of the given area
+    * are currently allocated. Untouched pages are not reported.
+    */
+   bitmap get_area_memlocation(const void* addr, size_t len) const
+   {
+      auto nodeset = bitmap::scratch(bitmap::scratch_slot::output);
+      hwloc_bitmap_zero(nodeset);
+      hwloc_get_area_memlocation(get(), addr, len, nodeset,
+                                 HWLOC_MEMBIND_BYNODESET);
+      return bitmap{nodeset};
+   }
+
+   /* Binds the pages of the given area to a set of NUMA nodes. With
+    * HWLOC_MEMBIND_MIGRATE, pages already allocated elsewhere are moved.
+    * Returns 0 on success, -1 with errno set otherwise.
+    */
+   int set_area_membind(const void* addr, size_t len, const bitmap& nodeset,
+                        int flags = HWLOC_MEMBIND_MIGRATE) const
+   {
+      if (!is_thissystem()) {
+         return 0;
+      }
+      return hwloc_set_area_membind(get(), addr, len, nodeset.as_hwloc(),
+                                    HWLOC_MEMBIND_BIND,
+                                    flags | HWLOC_MEMBIND_BYNODESET);
+   }
+
    /* Returns the last cpu where the thread executed
     */
    bitmap get_last_cpu_location(cpubind b) const
    {
-      bitmap loc;
-      auto err =
-          hwloc_get_last_cpu_location(get(), loc.get(), static_cast<int>(b));
+      if (!is_thissystem()) {
+         bitmap loc;
+         auto bound = get_cpubind(b);
+         if (!bound.empty()) {
+            loc.set(bound.first());
+         }
+         return loc;
+      }
+      auto loc = bitmap::scratch(bitmap::scratch_slot::output);
+      auto err = hwloc_get_last_cpu_location(get(), loc, static_cast<int>(b));
       if (err > 0) {
          std::terminate();
       }
-      return {loc};
+      return bitmap{loc};
    }
 
    /* Returns the current CPU bind set for the process
     */
    bitmap get_cpubind(cpubind b) const
    {
-      bitmap cpuBind;
-      auto err = hwloc_get_cpubind(get(), cpuBind.get(), static_cast<int>(b));
+      if (!is_thissystem()) {
+         const auto& bound = stubbed_binding();
+         if (b == cpubind::thread && !bound.empty()) {
+            return bound;
+         }
+         auto& process = stubbed_process_binding();
+         std::lock_guard<std::mutex> lock{process.m};
+         if (!process.bound.empty()) {
+            return process.bound;
+         }
+         return bitmap{hwloc_topology_get_allowed_cpuset(get())};
+      }
+      auto cpuBind = bitmap::scratch(bitmap::scratch_slot::output);
+      auto err = hwloc_get_cpubind(get(), cpuBind, static_cast<int>(b));
       if (err > 0) {
          std::terminate();
       }
-      return {cpuBind};
+      return bitmap{cpuBind};
    }
 
    /* Sets a new CPU bind set for the THREAD
     */
    void set_cpubind(const bitmap& new_set, cpubind b)
    {
-      hwloc_set_cpubind(get(), new_set.get(), static_cast<int>(b));
+      if (!is_thissystem()) {
+         if (b == cpubind::thread) {
+            stubbed_binding() = new_set;
+         }
+         else {
+            auto& process = stubbed_process_binding();
+            std::lock_guard<std::mutex> lock{process.m};
+            process.bound = new_set;
+         }
+         return;
+      }
+      hwloc_set_cpubind(get(), new_set.as_hwloc(), static_cast<int>(b));
    }
 
    protected:
    std::shared_ptr<hwloc_topology> topology_;
+
+   private:
+   /* Initialises, configures and loads the topology.
+    * configure returns a negative value if the configuration is invalid.
+    */
+   template <typename Configure>
+   void load(Configure&& configure, const filters& f)
+   {
+      hwloc_topology_t system = nullptr;
+      hwloc_topology_init(&system);
+      topology_ = std::shared_ptr<hwloc_topology>{
+          system, [=](hwloc_topology_t ptr) { hwloc_topology_destroy(ptr); }};
+      if (configure(system) < 0
+          || hwloc_topology_set_io_types_filter(system, f.io) < 0
+          || hwloc_topology_set_icache_types_filter(system, f.icaches) < 0
+          || hwloc_topology_load(system) < 0) {
+         throw std::invalid_argument{"hwlocxx: cannot load topology"};
+      }
+   }
+
+   /* Binding of the calling thread on topologies of other machines */
+   static bitmap& stubbed_binding()
+   {
+      static thread_local bitmap bound;
+      return bound;
+   }
+
+   struct process_binding
+   {
+      std::mutex m;
+      bitmap bound;
+   };
+
+   /* Binding of the process on topologies of other machines, seen by
+    * threads that did not bind themselves
+    */
+   static process_binding& stubbed_process_binding()
+   {
+      static process_binding binding;
+      return binding;
+   }
 };
+template <typename Value>
+Value object_view<Value>::iterator::operator*() const
+{
+   topology::object o{topo_, current_};
+   if constexpr (std::is_same_v<Value, topology::object>) {
+      return o;
+   }
+   else {
+      return Value{o};
+   }
+}
 }; // namespace hwlocxx
@@ -13,15 +13,48 @@
   limitations under the License.
 */
 
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
 #include <future>
+#include <mutex>
 #include <optional>
-#include <sstream>
+#include <string_view>
+#include <thread>
 
 namespace hwlocxx
 {
+
+/* Granularity used to keep independently written data apart */
+constexpr size_t cache_line_size = 64;
+
 namespace experimental
 {
+   namespace detail
+   {
+      inline void cpu_relax()
+      {
+#if defined(__x86_64__) || defined(__i386__)
+         __builtin_ia32_pause();
+#endif
+      }
+
+      template <typename T>
+      struct alignas(cache_line_size) padded
+      {
+         T value;
+      };
+
+      /* Increments a counter that only the calling thread writes */
+      inline void bump(std::atomic<std::uint64_t>& counter)
+      {
+         counter.store(counter.load(std::memory_order_relaxed) + 1,
+                       std::memory_order_relaxed);
+      }
+   } // namespace detail
+
    struct thread_execution_resource_t
    {
       friend class ExecutionContext;
@@ -50,22 +83,13 @@ namespace experimental
 
       size_t partition_size() const { return o_.get()->arity; }
 
-      std::string name() const
-      {
-         std::stringstream s;
-         s << o_ << std::endl;
-         return s.str();
-      }
+      /* Type of the underlying object, e.g. "Package" */
+      std::string_view name() const { return o_.get_type_name(); }
 
-      std::vector<thread_execution_resource_t> resources()
+      /* Resources one level down, built lazily while iterating */
+      object_view<thread_execution_resource_t> resources() const
       {
-         auto subtreeObj = o_.get_descendants();
-         std::vector<thread_execution_resource_t> retVal;
-         retVal.reserve(subtreeObj.size());
-         for (auto o : subtreeObj) {
-            retVal.emplace_back(o);
-         }
-         return retVal;
+         return o_.get_children().as<thread_execution_resource_t>();
       }
 
       /**
@@ -90,57 +114,350 @@ namespace experimental
       hwlocxx::topology::object o_;
    };
 
+   namespace this_thread
+   {
+      namespace detail
+      {
+         inline thread_local int logicalPU = -1;
+         // Worker running on the calling thread, if any
+         inline thread_local const void* worker = nullptr;
+      } // namespace detail
+
+      /**
+       * Logical index of the PU the calling worker is pinned to, or -1 if
+       * the calling thread is not a worker of an ExecutionContext.
+       */
+      inline int get_logical_pu() noexcept { return detail::logicalPU; }
+   } // namespace this_thread
+
+   namespace detail
+   {
+      /**
+       * Move-only type-erased nullary task, so functors owning a promise
+       * can be stored on the worker queues.
+       */
+      class task
+      {
+     public:
+         task() = default;
+
+         template <typename Function>
+         explicit task(Function&& func)
+             : impl_{std::make_unique<model<std::decay_t<Function>>>(
+                   std::forward<Function>(func))}
+         {
+         }
+
+         void operator()() { impl_->run(); }
+
+     private:
+         struct concept_t
+         {
+            virtual ~concept_t() = default;
+            virtual void run() = 0;
+         };
+
+         template <typename F>
+         struct model : concept_t
+         {
+            template <typename G>
+            explicit model(G&& f) : f_{std::forward<G>(f)}
+            {
+            }
+            void run() override { f_(); }
+            F f_;
+         };
+
+         std::unique_ptr<concept_t> impl_;
+      };
+
+      /**
+       * A thread pinned to one PU of the execution context, consuming
+       * tasks from its own queues. Latency tasks are always taken first.
+       */
+      struct worker
+      {
+         worker(hwlocxx::topology::object pu, size_t id) : pu_{pu}, id_{id} {}
+
+         bool has_work() const { return !latency_.empty() || !batch_.empty(); }
+
+         /* Publishes the queue length to spinning workers. Requires m_. */
+         void update_queued()
+         {
+            queued_.store(static_cast<unsigned>(latency_.size()
+                                                + batch_.size()),
+                          std::memory_order_release);
+         }
+
+         hwlocxx::topology::object pu_;
+         // Index of the worker in its context
+         size_t id_;
+         std::mutex m_;
+         std::condition_variable cv_;
+         std::deque<task> latency_;
+         std::deque<task> batch_;
+         // Length of the queues, readable without m_ while spinning
+         std::atomic<unsigned> queued_{0};
+         // Set to make an idle reserved worker look for work to borrow
+         std::atomic<bool> poked_{false};
+         // Workers of the same core currently running a task, null when
+         // no worker of the core would back off for its siblings
+         std::atomic<unsigned>* coreBusy_{nullptr};
+         // Current spin budget of the idle policy, only used by the worker
+         unsigned spinBudget_{0};
+         // Telemetry, only written by the worker itself
+         std::atomic<std::uint64_t> tasks_{0};
+         std::atomic<std::uint64_t> borrowed_{0};
+         std::atomic<std::uint64_t> parks_{0};
+         // Whether the worker is waiting on cv_, so submitters can skip
+         // the notification otherwise
+         bool sleeping_{false};
+         bool stop_{false};
+         std::thread thread_;
+      };
+
+      /**
+       * Snapshot of the PUs an ExecutionContext is allowed to run on,
+       * replaced as a whole whenever the process cpuset changes.
+       */
+      struct placement
+      {
+         // Unique in the process, so snapshots of different contexts
+         // never compare equal
+         std::uint64_t generation_{0};
+         bitmap partition_;
+         // PUs of the partition kept for the latency lane
+         bitmap reserved_;
+         // Workers whose PU is in the partition
+         std::vector<size_t> active_;
+         // Active workers receiving latency and batch work respectively
+         std::vector<size_t> latency_;
+         std::vector<size_t> batch_;
+         // Latency and batch workers local to each NUMA node, indexed by
+         // node OS index. Nodes without workers of a class get those of
+         // the closest node with some.
+         std::vector<std::vector<size_t>> nodeLatency_;
+         std::vector<std::vector<size_t>> nodeBatch_;
+      };
+   } // namespace detail
+
+   /**
+    * Submission classes. Latency tasks run on the reserved PUs of the
+    * context when there are any, and are always picked before batch tasks.
+    */
+   enum class priority
+   {
+      batch,
+      latency
+   };
+
+   /**
+    * How the workers of an ExecutionContext wait for work: spin with
+    * pause, then yield, then park until notified.
+    *
+    * When adaptive, the spin budget doubles whenever work arrives while
+    * spinning or shortly after parking, and halves when the worker stays
+    * parked longer, so it follows the arrival rate of tasks. While
+    * another PU of the same core runs a task, a spinning worker only
+    * uses a fraction of its budget so it does not slow its SMT sibling.
+    */
+   struct idle_policy
+   {
+      // Initial spin budget and its bounds, in pause iterations
+      unsigned spin = 1024;
+      unsigned min_spin = 64;
+      unsigned max_spin = 16384;
+      // Yields between spinning and parking
+      unsigned yields = 16;
+      bool adaptive = true;
+      // Parks shorter than this mean the spin budget was too short
+      std::chrono::microseconds short_park{50};
+      // Spin budget divisor while an SMT sibling is busy
+      unsigned sibling_busy_divisor = 8;
+
+      /* Park straight away, for oversubscribed or power-sensitive runs */
+      static idle_policy blocking()
+      {
+         idle_policy p;
+         p.spin = p.min_spin = p.max_spin = 0;
+         p.yields = 0;
+         p.adaptive = false;
+         return p;
+      }
+   };
+
    class ExecutionContext;
-   class locality_executor
+
+   /**
+    * Executor submitting work to the workers of an ExecutionContext.
+    *
+    * What it does is set by the values of the execution properties it
+    * carries: require() and prefer() return an executor with one of them
+    * replaced, and each submission function only contains the code of
+    * the values of its executor.
+    */
+   template <
+       typename Blocking = execution::blocking_t::possibly_t,
+       typename Relationship = execution::relationship_t::fork_t,
+       typename OutstandingWork = execution::outstanding_work_t::untracked_t,
+       typename BulkGuarantee = execution::bulk_guarantee_t::parallel_t,
+       typename Placement = execution::placement_t::round_robin_t>
+   class basic_locality_executor
    {
+      template <typename, typename, typename, typename, typename>
+      friend class basic_locality_executor;
 
   public:
-      explicit locality_executor(ExecutionContext& eC) : eC_{eC} {};
+      explicit basic_locality_executor(ExecutionContext& eC) : eC_{&eC}
+      {
+         start_work();
+      }
 
-      void prepare_thread();
+      basic_locality_executor(const basic_locality_executor& rhs)
+          : eC_{rhs.eC_}
+      {
+         start_work();
+      }
 
-      template <typename Function>
-      std::future<unsigned> twoway_execute(Function&& func)
+      basic_locality_executor& operator=(const basic_locality_executor& rhs)
       {
+         if (this != &rhs) {
+            rhs.start_work();
+            finish_work();
+            eC_ = rhs.eC_;
+         }
+         return *this;
+      }
 
-         using return_type = unsigned;
-         std::promise<return_type> promise;
-         auto fut = promise.get_future();
+      ~basic_locality_executor() { finish_work(); }
 
-         std::thread([ =, promise{std::move(promise)} ]() mutable {
-            try
-            {
-               prepare_thread();
-               // Run user-functor
-               auto result = func();
-               promise.set_value(result);
-            }
-            catch (...)
-            {
-               promise.set_exception(std::current_exception());
-            }
-         }).detach();
+      ExecutionContext& context() const noexcept { return *eC_; }
 
-         return fut;
+      /* Executor with the given property value, which must be one of the
+       * properties in execution_properties.hpp
+       */
+      template <typename Property>
+      auto require(const Property& p) const;
+
+      /* require(p) for supported properties, a copy of *this otherwise */
+      template <typename Property>
+      auto prefer(const Property& p) const;
+
+      static constexpr Blocking query(execution::blocking_t) { return {}; }
+      static constexpr Relationship query(execution::relationship_t)
+      {
+         return {};
+      }
+      static constexpr OutstandingWork query(execution::outstanding_work_t)
+      {
+         return {};
       }
+      static constexpr BulkGuarantee query(execution::bulk_guarantee_t)
+      {
+         return {};
+      }
+      static constexpr Placement query(execution::placement_t) { return {}; }
+
+      friend bool operator==(const basic_locality_executor& lhs,
+                             const basic_locality_executor& rhs) noexcept
+      {
+         return lhs.eC_ == rhs.eC_;
+      }
+
+      friend bool operator!=(const basic_locality_executor& lhs,
+                             const basic_locality_executor& rhs) noexcept
+      {
+         return lhs.eC_ != rhs.eC_;
+      }
+
+      /* Runs func on the lane given by the placement property */
+      template <typename Function>
+      std::future<unsigned> twoway_execute(Function&& func) const;
+
+      /* Runs func on the lane p, chosen at run time */
+      template <typename Function>
+      std::future<unsigned> twoway_execute(priority p, Function&& func) const;
+
+      /**
+       * Runs func on a worker local to the NUMA node holding ptr, in the
+       * lane given by the placement property of that worker.
+       * If no worker is local to it, the workers of the node with the
+       * lowest latency to it are used instead, and any worker if the
+       * memory is not backed yet.
+       */
+      template <typename Function>
+      std::future<unsigned> twoway_execute_near(const void* ptr,
+                                                Function&& func) const;
+
+      /**
+       * Enqueues every callable of range as batch work, publishing each
+       * worker's share with a single queue operation.
+       *
+       * The batch is cut into contiguous shares of at least grain tasks,
+       * given to consecutive workers in topology order. Only the workers
+       * receiving a share are woken up. By default (grain 0) there is at
+       * most one share per batch worker and shares hold at least 16
+       * tasks, so small batches only wake a few workers; pass a grain of
+       * 1 to spread a few long tasks over as many workers.
+       *
+       * With bulk_guarantee.sequenced the whole range runs in order as a
+       * single task instead, and with bulk_guarantee.unsequenced each
+       * share runs as a single task.
+       * Batches always go to the batch lane, whatever the placement
+       * property.
+       *
+       * @return Future ready once all the callables have run. It holds
+       * the first exception thrown by any of them, except with
+       * bulk_guarantee.unsequenced where callables must not throw: an
+       * exception escaping one of them calls std::terminate.
+       */
+      template <typename Range>
+      std::future<void> execute_batch(Range&& range, size_t grain = 0) const;
 
   private:
-      ExecutionContext& eC_;
+      static constexpr bool tracked =
+          std::is_same_v<OutstandingWork,
+                         execution::outstanding_work_t::tracked_t>;
+
+      static constexpr bool always =
+          std::is_same_v<Blocking, execution::blocking_t::always_t>;
+
+      // Lane of the placement property, carried down to the queues
+      static constexpr priority lane =
+          std::is_same_v<Placement, execution::placement_t::latency_t>
+              ? priority::latency
+              : priority::batch;
+
+      void start_work() const noexcept;
+      void finish_work() const noexcept;
+
+      template <priority P, typename Function>
+      std::future<unsigned> execute_on(Function&& func) const;
+
+      template <priority P, typename Function>
+      std::future<unsigned> submit(size_t worker, Function&& func) const;
+
+      gsl::not_null<ExecutionContext*> eC_;
    };
 
+   /* Executor with the default value of every property */
+   using locality_executor = basic_locality_executor<>;
+
+   class locality_auditor;
+
    class ExecutionContext
    {
-      friend class locality_executor;
+      template <typename, typename, typename, typename, typename>
+      friend class basic_locality_executor;
+      friend class locality_auditor;
 
   public:
       using execution_resource_t = thread_execution_resource_t;
 
-      ExecutionContext(execution_resource_t& eR)
-          : topo_{eR.get_object().get_topo()}, partition_(), eR_{eR}
-      {
-      }
+      ExecutionContext(execution_resource_t& eR,
+                       idle_policy policy = idle_policy{});
 
-      ~ExecutionContext() = default;
+      ~ExecutionContext();
 
       ExecutionContext(ExecutionContext const&) = delete;
       ExecutionContext(ExecutionContext&&) = delete;
@@ -153,7 +470,12 @@ namespace experimental
       locality_executor executor() { return locality_executor(*this); }
 
       // Waiting functions:
-      void wait() = delete;
+
+      /**
+       * Blocks until no executor requiring outstanding_work.tracked on
+       * this context exists anymore.
+       */
+      void wait();
       template <class Clock, class Duration>
       bool wait_until(std::chrono::time_point<Clock, Duration> const&) = delete;
       template <class Rep, class Period>
@@ -162,33 +484,128 @@ namespace experimental
       // Returns the topology of the system
       inline topology get_topology() const { return *topo_; }
 
+      // Returns the remote access cost model of the topology
+      const placement_cost& get_placement_cost() const { return cost_; }
+
+      /**
+       * Re-reads the set of PUs the process is allowed to run on, from
+       * its cpuset cgroup on Linux, so the bindings of the threads of
+       * the process (workers included) do not matter. If it changed,
+       * workers whose PU is no longer allowed stop receiving work and are
+       * moved onto the remaining PUs, and workers for newly allowed PUs
+       * are started. Every worker picks up its new binding at its next
+       * task boundary.
+       *
+       * @return Whether the placement changed.
+       */
+      bool refresh();
+
+      /**
+       * Keeps the PUs of cpuset that the context runs on for latency
+       * tasks. Batch tasks are not sent to them, but their workers borrow
+       * batch work while they have no latency work, one task at a time.
+       * An empty cpuset removes the reservation.
+       */
+      void reserve(const bitmap& cpuset);
+
+      /**
+       * Counters of every worker, and the last buffer residency published
+       * by a locality_auditor of this context. Counters are read without
+       * stopping the workers, so they are only consistent per worker.
+       */
+      metrics_snapshot metrics() const;
+
   protected:
-      void place_thread()
-      {
-         // Execute on a different thread that is on the same processor
-         // (will only work for HT)
-         // This returns an os index
-         const auto& currentThreadCPU =
-             get_topology().get_last_cpu_location(cpubind::thread);
-         stream_placement_info(std::cout);
-         const auto& allowedCPUs = get_topology().get_cpubind(cpubind::process);
-         // Other CPUs that are not the current one
-         auto remainingCPU{allowedCPUs.and_not(currentThreadCPU)};
-         // Other CPUs in the same core
-         auto obj =
-             get_topology().get_object_by_os_index(currentThreadCPU.first());
-         auto otherCore = obj.get_closest()[0];
-         std::cout << "Obj is " << otherCore << std::endl;
-         // get_topology().get_object_by_type(HWLOC_OBJ_CORE, 0);
-         get_topology().set_cpubind(remainingCPU, cpubind::thread);
-         stream_placement_info(std::cout);
-      }
+      /* Binds the calling worker according to the given placement */
+      void place_thread(const detail::worker& w,
+                        const detail::placement& p);
 
   private:
       gsl::not_null<const hwlocxx::topology*> topo_;
-      bitmap partition_;
       execution_resource_t& eR_;
 
+      // One worker per PU of the resource, started once the PU is allowed
+      std::vector<std::unique_ptr<detail::worker>> workers_;
+      // Current placement, and its generation. Submitters only read
+      // generation_ while the placement they last used is current, see
+      // current_placement(), and old placements are freed once no worker
+      // nor submitter uses them anymore.
+      std::shared_ptr<const detail::placement> placement_;
+      std::atomic<std::uint64_t> generation_{0};
+      std::mutex refreshM_;
+      bitmap reserved_;
+      std::atomic<size_t> next_{0};
+      // Reserved workers currently looking for work
+      std::atomic<unsigned> idleReserved_{0};
+      idle_policy policy_;
+      placement_cost cost_;
+      // Latest results of the auditor, see metrics()
+      std::shared_ptr<const std::vector<buffer_locality>> locality_;
+      // Tracked executors alive, see wait()
+      std::atomic<size_t> outstanding_{0};
+      std::mutex workM_;
+      std::condition_variable workCv_;
+      // Workers running a task, one counter per core
+      std::unique_ptr<detail::padded<std::atomic<unsigned>>[]> coreBusy_;
+
+      /* Computes and publishes a new placement. Requires refreshM_. */
+      void publish(const bitmap& partition);
+
+      /**
+       * Current placement, cached per thread by generation so submitters
+       * do not touch its reference count. The reference stays valid until
+       * the next call on the same thread.
+       */
+      const detail::placement& current_placement() const;
+
+      void run_worker(detail::worker& w);
+
+      /**
+       * Idles according to the policy until w may have something to do.
+       * @return false if the worker has to stop.
+       */
+      bool wait_for_work(detail::worker& w, std::uint64_t placed);
+
+      /* Takes one batch task queued on a batch worker */
+      bool borrow(const detail::placement& p, detail::task& t);
+
+      /* Queues t on the lane P of a worker */
+      template <priority P>
+      void enqueue(size_t worker, detail::task t);
+
+      /* Spreads tasks over the batch workers, see execute_batch */
+      void enqueue_batch(std::vector<detail::task> tasks, size_t grain);
+
+      // Smallest share of a batch when the caller gives no grain
+      static constexpr size_t min_share = 16;
+
+      /* Grain of a batch of n tasks, picked if grain is 0 */
+      size_t batch_grain(size_t n, size_t grain) const;
+
+      /* Pokes an idle reserved worker so it borrows new batch work */
+      void offer_to_reserved();
+
+      /* Round-robin choice of a worker for the class P */
+      template <priority P>
+      size_t next_worker();
+
+      /* Choice of a worker of the class P local to the memory at ptr */
+      template <priority P>
+      size_t worker_near(const void* ptr);
+
+      /* Workers among ids local to each NUMA node, see placement */
+      std::vector<std::vector<size_t>>
+      workers_by_node(const std::vector<size_t>& ids) const;
+
+      /* Index of the worker of this context running the caller, if any */
+      std::optional<size_t> current_worker() const noexcept;
+
+      /* Number of workers currently receiving batch work */
+      size_t batch_width() const;
+
+      void work_started() noexcept;
+      void work_finished() noexcept;
+
       /*
        * Outputs placement information for the current thread
        * to the givem output stream
@@ -218,6 +635,347 @@ namespace experimental
       }
    };
 
+   template <typename B, typename R, typename W, typename G, typename P>
+   template <typename Property>
+   auto basic_locality_executor<B, R, W, G, P>::require(const Property&) const
+   {
+      using property = execution::detail::property_of_t<Property>;
+      static_assert(execution::is_property_value_v<Property>,
+                    "hwlocxx: unsupported executor property");
+      if constexpr (std::is_same_v<property, execution::blocking_t>) {
+         return basic_locality_executor<Property, R, W, G, P>{*eC_};
+      }
+      else if constexpr (std::is_same_v<property, execution::relationship_t>) {
+         return basic_locality_executor<B, Property, W, G, P>{*eC_};
+      }
+      else if constexpr (std::is_same_v<property,
+                                        execution::outstanding_work_t>) {
+         return basic_locality_executor<B, R, Property, G, P>{*eC_};
+      }
+      else if constexpr (std::is_same_v<property,
+                                        execution::bulk_guarantee_t>) {
+         return basic_locality_executor<B, R, W, Property, P>{*eC_};
+      }
+      else {
+         return basic_locality_executor<B, R, W, G, Property>{*eC_};
+      }
+   }
+
+   template <typename B, typename R, typename W, typename G, typename P>
+   template <typename Property>
+   auto basic_locality_executor<B, R, W, G, P>::prefer(const Property& p) const
+   {
+      if constexpr (execution::is_property_value_v<Property>) {
+         return require(p);
+      }
+      else {
+         return *this;
+      }
+   }
+
+   template <typename B, typename R, typename W, typename G, typename P>
+   template <typename Function>
+   std::future<unsigned>
+   basic_locality_executor<B, R, W, G, P>::twoway_execute(Function&& func) const
+   {
+      return execute_on<lane>(std::forward<Function>(func));
+   }
+
+   template <typename B, typename R, typename W, typename G, typename P>
+   template <typename Function>
+   std::future<unsigned>
+   basic_locality_executor<B, R, W, G, P>::twoway_execute(priority p,
+                                                          Function&& func) const
+   {
+      if (p == priority::latency) {
+         return execute_on<priority::latency>(std::forward<Function>(func));
+      }
+      return execute_on<priority::batch>(std::forward<Function>(func));
+   }
+
+   template <typename B, typename R, typename W, typename G, typename P>
+   template <priority Lane, typename Function>
+   std::future<unsigned>
+   basic_locality_executor<B, R, W, G, P>::execute_on(Function&& func) const
+   {
+      if constexpr (std::is_same_v<R,
+                                   execution::relationship_t::continuation_t>) {
+         if (auto current = eC_->current_worker()) {
+            return submit<Lane>(*current, std::forward<Function>(func));
+         }
+      }
+      return submit<Lane>(eC_->next_worker<Lane>(),
+                          std::forward<Function>(func));
+   }
+
+   template <typename B, typename R, typename W, typename G, typename P>
+   template <typename Function>
+   std::future<unsigned>
+   basic_locality_executor<B, R, W, G, P>::twoway_execute_near(
+       const void* ptr, Function&& func) const
+   {
+      return submit<lane>(eC_->worker_near<lane>(ptr),
+                          std::forward<Function>(func));
+   }
+
+   template <typename B, typename R, typename W, typename G, typename P>
+   template <typename Range>
+   std::future<void>
+   basic_locality_executor<B, R, W, G, P>::execute_batch(Range&& range,
+                                                         size_t grain) const
+   {
+      struct batch_state
+      {
+         std::atomic<size_t> remaining;
+         std::promise<void> done;
+         std::mutex m;
+         std::exception_ptr error;
+      };
+
+      auto state = std::make_shared<batch_state>();
+      auto fut = state->done.get_future();
+      const auto n = static_cast<size_t>(
+          std::distance(std::begin(range), std::end(range)));
+      if (n == 0) {
+         state->done.set_value();
+         return fut;
+      }
+
+      // Waiting on our own worker would never return, run it here
+      if constexpr (always) {
+         if (eC_->current_worker()) {
+            try
+            {
+               for (auto&& func : range) {
+                  func();
+               }
+               state->done.set_value();
+            }
+            catch (...)
+            {
+               state->done.set_exception(std::current_exception());
+            }
+            return fut;
+         }
+      }
+
+      if constexpr (std::is_same_v<G,
+                                   execution::bulk_guarantee_t::sequenced_t>) {
+         using element = std::decay_t<decltype(*std::begin(range))>;
+         std::vector<element> funcs{std::begin(range), std::end(range)};
+         eC_->enqueue<priority::batch>(
+             eC_->next_worker<priority::batch>(),
+             detail::task{[ state, funcs = std::move(funcs) ]() mutable {
+                try
+                {
+                   for (auto& func : funcs) {
+                      func();
+                   }
+                   state->done.set_value();
+                }
+                catch (...)
+                {
+                   state->done.set_exception(std::current_exception());
+                }
+             }});
+      }
+      else if constexpr (std::is_same_v<
+                             G, execution::bulk_guarantee_t::unsequenced_t>) {
+         // One task per share: no exception handling nor completion count
+         // per element
+         using element = std::decay_t<decltype(*std::begin(range))>;
+         auto funcs = std::make_shared<std::vector<element>>(std::begin(range),
+                                                             std::end(range));
+         const auto width = std::max<size_t>(eC_->batch_width(), 1);
+         const auto share =
+             std::max(eC_->batch_grain(n, grain), (n + width - 1) / width);
+         const auto shares = (n + share - 1) / share;
+         state->remaining = shares;
+
+         std::vector<detail::task> tasks;
+         tasks.reserve(shares);
+         for (size_t begin = 0; begin < n; begin += share) {
+            const auto end = std::min(begin + share, n);
+            tasks.emplace_back([state, funcs, begin, end]() noexcept {
+               for (auto i = begin; i < end; i++) {
+                  (*funcs)[i]();
+               }
+               if (--state->remaining == 0) {
+                  state->done.set_value();
+               }
+            });
+         }
+         eC_->enqueue_batch(std::move(tasks), 1);
+      }
+      else {
+         state->remaining = n;
+
+         std::vector<detail::task> tasks;
+         tasks.reserve(n);
+         for (auto&& func : range) {
+            tasks.emplace_back(
+                [ state, func = std::forward<decltype(func)>(func) ]() mutable {
+                   try
+                   {
+                      func();
+                   }
+                   catch (...)
+                   {
+                      std::lock_guard<std::mutex> lock{state->m};
+                      if (!state->error) {
+                         state->error = std::current_exception();
+                      }
+                   }
+                   if (--state->remaining == 0) {
+                      if (state->error) {
+                         state->done.set_exception(state->error);
+                      }
+                      else {
+                         state->done.set_value();
+                      }
+                   }
+                });
+         }
+         eC_->enqueue_batch(std::move(tasks), eC_->batch_grain(n, grain));
+      }
+
+      if constexpr (always) {
+         fut.wait();
+      }
+      return fut;
+   }
+
+   template <typename B, typename R, typename W, typename G, typename P>
+   template <priority Lane, typename Function>
+   std::future<unsigned>
+   basic_locality_executor<B, R, W, G, P>::submit(size_t worker,
+                                                  Function&& func) const
+   {
+      using return_type = unsigned;
+      std::promise<return_type> promise;
+      auto fut = promise.get_future();
+
+      detail::task t{[
+         func = std::forward<Function>(func), promise{std::move(promise)}
+      ]() mutable {
+         try
+         {
+            // Run user-functor
+            auto result = func();
+            promise.set_value(result);
+         }
+         catch (...)
+         {
+            promise.set_exception(std::current_exception());
+         }
+      }};
+
+      if constexpr (always) {
+         // Waiting on our own worker would never return, run it here
+         if (eC_->current_worker() == worker) {
+            t();
+            return fut;
+         }
+         eC_->enqueue<Lane>(worker, std::move(t));
+         fut.wait();
+      }
+      else {
+         eC_->enqueue<Lane>(worker, std::move(t));
+      }
+      return fut;
+   }
+
+   template <typename B, typename R, typename W, typename G, typename P>
+   void basic_locality_executor<B, R, W, G, P>::start_work() const noexcept
+   {
+      if constexpr (tracked) {
+         eC_->work_started();
+      }
+   }
+
+   template <typename B, typename R, typename W, typename G, typename P>
+   void basic_locality_executor<B, R, W, G, P>::finish_work() const noexcept
+   {
+      if constexpr (tracked) {
+         eC_->work_finished();
+      }
+   }
+
+   /**
+    * One member of each group below root, e.g. one PU per core
+    * (HWLOC_OBJ_CORE, HWLOC_OBJ_PU) or one core per L3
+    * (HWLOC_OBJ_L3CACHE, HWLOC_OBJ_CORE). Suitable for
+    * ExecutionContext::reserve.
+    */
+   bitmap first_in_each(const hwlocxx::topology::object& root,
+                        hwloc_obj_type_t group,
+                        hwloc_obj_type_t member = HWLOC_OBJ_PU);
+
+   /**
+    * Resource made of the PUs closest to an OS device, e.g. "eth0" or
+    * "nvme0n1": those of the first non-I/O ancestor of the device.
+    * The topology must be loaded with I/O objects, see
+    * topology::filters::with_io().
+    *
+    * @throw std::invalid_argument if the topology has no such device.
+    */
+   thread_execution_resource_t device_resource(const topology& topo,
+                                               const std::string& device);
+
+   /* Allocator of memory local to an OS device, see device_resource */
+   template <typename T>
+   allocator<T> device_allocator(const topology& topo,
+                                 const std::string& device)
+   {
+      return allocator<T>{topo, device_resource(topo, device).get_object()};
+   }
+
+   namespace detail
+   {
+      /* Keeps the resource of a device_context alive before its base
+       * ExecutionContext is built on it.
+       */
+      struct device_resource_holder
+      {
+         thread_execution_resource_t deviceResource_;
+      };
+   } // namespace detail
+
+   /**
+    * ExecutionContext whose workers run on the PUs closest to an OS
+    * device, for the threads driving a NIC or an NVMe drive.
+    */
+   class device_context : private detail::device_resource_holder,
+                          public ExecutionContext
+   {
+  public:
+      device_context(const topology& topo, const std::string& device,
+                     idle_policy policy = idle_policy{});
+   };
+
+   /**
+    * Polls the process cpuset on a background thread and refreshes an
+    * ExecutionContext when it changes, e.g. when the cgroup of a container
+    * is resized. Submissions never query the kernel themselves.
+    */
+   class cpuset_watcher
+   {
+  public:
+      cpuset_watcher(ExecutionContext& eC, std::chrono::milliseconds period);
+      ~cpuset_watcher();
+
+      cpuset_watcher(const cpuset_watcher&) = delete;
+      cpuset_watcher& operator=(const cpuset_watcher&) = delete;
+
+  private:
+      ExecutionContext& eC_;
+      std::chrono::milliseconds period_;
+      std::mutex m_;
+      std::condition_variable cv_;
+      bool stop_{false};
+      std::thread thread_;
+   };
+
    namespace this_system
    {
       auto resources() -> decltype(std::vector<thread_execution_resource_t>());
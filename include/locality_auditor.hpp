@@ -0,0 +1,90 @@
+/* Copyright 2017 Ruyman Reyes
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef HWLOCXX_LOCALITY_AUDITOR_HPP
+#define HWLOCXX_LOCALITY_AUDITOR_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace hwlocxx
+{
+namespace experimental
+{
+   /**
+    * Checks that watched buffers really live where they are expected to.
+    *
+    * A background thread samples the page residency of every watched
+    * buffer each period, one page out of every stride pages, and
+    * publishes the share of backed pages found on the expected nodes in
+    * the metrics() of the context. The thread is pinned to the last PU
+    * of the context and runs at idle priority where the system allows it,
+    * so it does not compete with the workers.
+    */
+   class locality_auditor
+   {
+  public:
+      locality_auditor(ExecutionContext& eC, std::chrono::milliseconds period,
+                       size_t stride = 16);
+      ~locality_auditor();
+
+      locality_auditor(const locality_auditor&) = delete;
+      locality_auditor& operator=(const locality_auditor&) = delete;
+
+      /* Audits [ptr, ptr + len), expected on the nodes of the context */
+      void watch(std::string name, const void* ptr, size_t len);
+
+      /* Audits [ptr, ptr + len), expected on nodeset */
+      void watch(std::string name, const void* ptr, size_t len,
+                 const bitmap& nodeset);
+
+      /**
+       * Stops auditing the buffer starting at ptr. Once it returns the
+       * buffer is not being sampled, so it can be freed.
+       */
+      void unwatch(const void* ptr);
+
+      /* Samples every watched buffer now and publishes the results */
+      void sample();
+
+  private:
+      struct watched
+      {
+         std::string name;
+         const void* ptr;
+         size_t len;
+         bitmap expected;
+      };
+
+      /* Requires m_ */
+      void sample_locked();
+
+      ExecutionContext& eC_;
+      std::chrono::milliseconds period_;
+      size_t stride_;
+      std::vector<watched> buffers_;
+      std::mutex m_;
+      std::condition_variable cv_;
+      bool stop_{false};
+      std::thread thread_;
+   };
+
+} // namespace experimental
+} // namespace hwlocxx
+#endif // HWLOCXX_LOCALITY_AUDITOR_HPP
@@ -0,0 +1,173 @@
+/* Copyright 2017 Ruyman Reyes
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef HWLOCXX_MEMORY_REGIONS_HPP
+#define HWLOCXX_MEMORY_REGIONS_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+
+#include <unistd.h>
+
+namespace hwlocxx
+{
+
+/**
+ * Process-wide cache of the NUMA nodes backing regions of memory.
+ *
+ * Buffers allocated through hwlocxx::allocator on the topology of this
+ * machine are registered with the nodeset they are bound to, updated
+ * when their pages are migrated, and dropped when they are freed, so
+ * lookups inside them do not go to the kernel. Any other address is queried
+ * through the topology on every lookup: its pages may be freed, reused
+ * or moved by the kernel without the registry knowing.
+ */
+class memory_regions
+{
+   public:
+   static memory_regions& instance()
+   {
+      static memory_regions regions;
+      return regions;
+   }
+
+   memory_regions(const memory_regions&) = delete;
+   memory_regions& operator=(const memory_regions&) = delete;
+
+   /**
+    * Records that [ptr, ptr + len) lives on nodeset.
+    * Any previously cached region overlapping it is dropped.
+    */
+   void insert(const void* ptr, size_t len, const bitmap& nodeset)
+   {
+      auto begin = reinterpret_cast<std::uintptr_t>(ptr);
+      std::unique_lock<std::shared_mutex> lock{m_};
+      erase_overlapping(begin, begin + len);
+      regions_.emplace(begin, entry{begin + len, nodeset});
+   }
+
+   /**
+    * Records that the registered parts of [ptr, ptr + len) now live on
+    * nodeset. Regions only partly covered are split, and memory that is
+    * not registered stays unregistered.
+    */
+   void update(const void* ptr, size_t len, const bitmap& nodeset)
+   {
+      auto begin = reinterpret_cast<std::uintptr_t>(ptr);
+      auto end = begin + len;
+      std::unique_lock<std::shared_mutex> lock{m_};
+      auto it = first_overlapping(begin);
+      while (it != regions_.end() && it->first < end) {
+         const auto rBegin = it->first;
+         const auto rEnd = it->second.end;
+         auto old = std::move(it->second.nodeset);
+         it = regions_.erase(it);
+         if (rBegin < begin) {
+            regions_.emplace(rBegin, entry{begin, old});
+         }
+         if (end < rEnd) {
+            regions_.emplace(end, entry{rEnd, std::move(old)});
+         }
+         regions_.emplace(std::max(rBegin, begin),
+                          entry{std::min(rEnd, end), nodeset});
+      }
+   }
+
+   /**
+    * Forgets the regions inside [ptr, ptr + len), including the pieces
+    * update() may have split them into.
+    */
+   void erase(const void* ptr, size_t len)
+   {
+      auto begin = reinterpret_cast<std::uintptr_t>(ptr);
+      std::unique_lock<std::shared_mutex> lock{m_};
+      erase_overlapping(begin, begin + len);
+   }
+
+   /**
+    * Returns the nodeset of the region containing ptr.
+    * On a miss, the page holding ptr is queried, and an empty nodeset is
+    * returned if it is not backed by memory yet.
+    */
+   bitmap resolve(const topology& topo, const void* ptr)
+   {
+      auto addr = reinterpret_cast<std::uintptr_t>(ptr);
+      {
+         std::shared_lock<std::shared_mutex> lock{m_};
+         auto it = find(addr);
+         if (it != regions_.end()) {
+            return it->second.nodeset;
+         }
+      }
+
+      const auto page = page_size();
+      return topo.get_area_memlocation(
+          reinterpret_cast<const void*>(addr & ~(page - 1)), page);
+   }
+
+   private:
+   memory_regions() = default;
+
+   struct entry
+   {
+      std::uintptr_t end;
+      bitmap nodeset;
+   };
+
+   using region_map = std::map<std::uintptr_t, entry>;
+
+   static std::uintptr_t page_size()
+   {
+      static const auto size =
+          static_cast<std::uintptr_t>(sysconf(_SC_PAGESIZE));
+      return size;
+   }
+
+   region_map::const_iterator find(std::uintptr_t addr) const
+   {
+      auto it = regions_.upper_bound(addr);
+      if (it == regions_.begin()) {
+         return regions_.end();
+      }
+      --it;
+      return (addr < it->second.end) ? it : regions_.end();
+   }
+
+   region_map::iterator first_overlapping(std::uintptr_t begin)
+   {
+      auto it = regions_.lower_bound(begin);
+      if (it != regions_.begin() && std::prev(it)->second.end > begin) {
+         --it;
+      }
+      return it;
+   }
+
+   void erase_overlapping(std::uintptr_t begin, std::uintptr_t end)
+   {
+      auto it = first_overlapping(begin);
+      while (it != regions_.end() && it->first < end) {
+         it = regions_.erase(it);
+      }
+   }
+
+   mutable std::shared_mutex m_;
+   region_map regions_;
+};
+
+} // namespace hwlocxx
+#endif // HWLOCXX_MEMORY_REGIONS_HPP
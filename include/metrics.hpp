@@ -0,0 +1,76 @@
+/* Copyright 2017 Ruyman Reyes
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef HWLOCXX_METRICS_HPP
+#define HWLOCXX_METRICS_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace hwlocxx
+{
+namespace experimental
+{
+   /* Counters of one worker of an ExecutionContext */
+   struct worker_metrics
+   {
+      int logical_pu;
+      // Tasks run, including borrowed ones
+      std::uint64_t tasks;
+      // Batch tasks taken from other workers by a reserved worker
+      std::uint64_t borrowed;
+      // Times the worker went to sleep waiting for work
+      std::uint64_t parks;
+      // Tasks waiting in its queues
+      unsigned queued;
+   };
+
+   /* Where the pages of an audited buffer were last seen */
+   struct buffer_locality
+   {
+      std::string name;
+      const void* address;
+      size_t bytes;
+      // NUMA nodes the buffer is expected to live on
+      bitmap expected;
+      // Pages sampled, sampled pages not backed yet, and backed pages
+      // found on the expected nodes
+      size_t sampled;
+      size_t unmapped;
+      size_t local;
+      // Share of the backed pages found on the expected nodes, empty while
+      // no sampled page is backed
+      std::optional<double> local_fraction;
+      std::chrono::steady_clock::time_point sampled_at;
+   };
+
+   /**
+    * Telemetry of an ExecutionContext at one point in time, see
+    * ExecutionContext::metrics().
+    */
+   struct metrics_snapshot
+   {
+      std::chrono::steady_clock::time_point taken_at;
+      std::vector<worker_metrics> workers;
+      // Latest results of the locality_auditor of the context, if any
+      std::vector<buffer_locality> buffers;
+   };
+
+} // namespace experimental
+} // namespace hwlocxx
+#endif // HWLOCXX_METRICS_HPP
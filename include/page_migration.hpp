@@ -0,0 +1,195 @@
+/* Copyright 2017 Ruyman Reyes
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef HWLOCXX_PAGE_MIGRATION_HPP
+#define HWLOCXX_PAGE_MIGRATION_HPP
+
+#include <cerrno>
+#include <cstdint>
+#include <future>
+#include <optional>
+#include <system_error>
+#include <vector>
+
+#include <unistd.h>
+
+namespace hwlocxx
+{
+namespace experimental
+{
+   namespace detail
+   {
+      inline std::uintptr_t page_size()
+      {
+         static const auto size =
+             static_cast<std::uintptr_t>(sysconf(_SC_PAGESIZE));
+         return size;
+      }
+   } // namespace detail
+
+   /**
+    * Where the pages of a buffer currently live.
+    */
+   struct page_residency
+   {
+      // Pages found on each NUMA node, indexed by node OS index
+      std::vector<size_t> pages;
+      // Pages not backed by memory yet (never touched)
+      size_t unmapped{0};
+      // Pages inspected
+      size_t sampled{0};
+
+      /**
+       * Fraction of the backed pages that live on the given nodes, or
+       * nothing if no inspected page is backed yet: an untouched buffer
+       * is not on the wrong nodes.
+       */
+      std::optional<double> fraction_on(const bitmap& nodeset) const
+      {
+         size_t on = 0;
+         for (int n : nodeset) {
+            if (static_cast<size_t>(n) < pages.size()) {
+               on += pages[n];
+            }
+         }
+         const auto backed = sampled - unmapped;
+         if (backed == 0) {
+            return std::nullopt;
+         }
+         return static_cast<double>(on) / backed;
+      }
+   };
+
+   /**
+    * Queries the NUMA node of the pages of [ptr, ptr + len), one page out
+    * of every stride pages.
+    */
+   inline page_residency get_residency(const hwlocxx::topology& topo,
+                                       const void* ptr, size_t len,
+                                       size_t stride = 1)
+   {
+      const auto page = detail::page_size();
+      const auto step = page * std::max<size_t>(stride, 1);
+      const auto begin = reinterpret_cast<std::uintptr_t>(ptr) & ~(page - 1);
+      const auto end = reinterpret_cast<std::uintptr_t>(ptr) + len;
+
+      page_residency residency;
+      for (auto addr = begin; addr < end; addr += step) {
+         auto nodeset = topo.get_area_memlocation(
+             reinterpret_cast<const void*>(addr), page);
+         residency.sampled++;
+         const int node = nodeset.first();
+         if (node < 0) {
+            residency.unmapped++;
+            continue;
+         }
+         if (residency.pages.size() <= static_cast<size_t>(node)) {
+            residency.pages.resize(node + 1);
+         }
+         residency.pages[node]++;
+      }
+      return residency;
+   }
+
+   namespace detail
+   {
+      struct migration
+      {
+         hwlocxx::topology topo;
+         bitmap nodeset;
+         std::uintptr_t begin;
+         std::uintptr_t end;
+         // Chunks are aligned on the page holding begin
+         std::uintptr_t base;
+         size_t chunk;
+         locality_executor ex;
+         std::promise<void> done;
+      };
+
+      /* Migrates the chunk starting at addr and schedules the next one */
+      inline void migrate_chunk(std::shared_ptr<migration> m,
+                                std::uintptr_t addr)
+      {
+         const auto next = std::min(
+             m->base + ((addr - m->base) / m->chunk + 1) * m->chunk, m->end);
+         if (m->topo.set_area_membind(reinterpret_cast<const void*>(addr),
+                                      next - addr, m->nodeset)
+             < 0) {
+            m->done.set_exception(std::make_exception_ptr(std::system_error{
+                errno, std::generic_category(), "hwlocxx: page migration"}));
+            return;
+         }
+
+         if (next < m->end) {
+            m->ex.twoway_execute([m, next]() -> unsigned {
+               migrate_chunk(m, next);
+               return 0u;
+            });
+            return;
+         }
+
+         // Pages of synthetic or XML topologies are not really moved
+         if (m->topo.is_thissystem()) {
+            memory_regions::instance().update(
+                reinterpret_cast<const void*>(m->begin), m->end - m->begin,
+                m->nodeset);
+         }
+         m->done.set_value();
+      }
+   } // namespace detail
+
+   /**
+    * Moves the pages of [ptr, ptr + len) to the NUMA nodes of target, in
+    * the background on ex.
+    *
+    * Pages are migrated chunk bytes at a time, one batch task per chunk,
+    * and each task only enqueues the next one when it is done. At most
+    * one worker is migrating at a time and latency work is never stuck
+    * behind a migration. Later allocations of pages of the area also go
+    * to target. Once the migration finishes, the locality recorded for
+    * buffers of hwlocxx::allocator inside the area is updated for
+    * twoway_execute_near; other memory is not recorded.
+    *
+    * @return Future ready when all the pages have been moved, holding a
+    * std::system_error if the kernel refused to move them.
+    */
+   inline std::future<void> migrate(locality_executor ex, const void* ptr,
+                                    size_t len,
+                                    const hwlocxx::topology::object& target,
+                                    size_t chunk = 2u << 20)
+   {
+      const auto page = detail::page_size();
+      const auto addr = reinterpret_cast<std::uintptr_t>(ptr);
+      auto m = std::make_shared<detail::migration>(detail::migration{
+          *target.get_topo(), target.get_nodeset(), addr, addr + len,
+          addr & ~(page - 1),
+          std::max<size_t>((chunk + page - 1) & ~(page - 1), page), ex,
+          std::promise<void>{}});
+      auto fut = m->done.get_future();
+      if (len == 0) {
+         m->done.set_value();
+         return fut;
+      }
+
+      ex.twoway_execute([m, addr]() -> unsigned {
+         detail::migrate_chunk(m, addr);
+         return 0u;
+      });
+      return fut;
+   }
+
+} // namespace experimental
+} // namespace hwlocxx
+#endif // HWLOCXX_PAGE_MIGRATION_HPP
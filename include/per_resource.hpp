@@ -0,0 +1,237 @@
+/* Copyright 2017 Ruyman Reyes
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef HWLOCXX_PER_RESOURCE_HPP
+#define HWLOCXX_PER_RESOURCE_HPP
+
+#include <vector>
+
+namespace hwlocxx
+{
+namespace experimental
+{
+   namespace detail
+   {
+      /**
+       * Cache-line aligned slots, each one allocated on the NUMA nodes of
+       * the object it belongs to.
+       */
+      template <typename T>
+      class local_slots
+      {
+     public:
+         explicit local_slots(const hwlocxx::topology& topo) : topo_{topo} {}
+
+         ~local_slots()
+         {
+            for (auto& s : slots_) {
+               allocator<padded<T>> a{topo_, s.obj};
+               s.ptr->~padded<T>();
+               a.deallocate(s.ptr, 1);
+            }
+         }
+
+         local_slots(const local_slots&) = delete;
+         local_slots& operator=(const local_slots&) = delete;
+
+         template <typename... Args>
+         void emplace_back(const hwlocxx::topology::object& o,
+                           const Args&... args)
+         {
+            allocator<padded<T>> a{topo_, o};
+            auto* ptr = a.allocate(1);
+            if (!ptr) {
+               throw std::bad_alloc{};
+            }
+            try
+            {
+               ::new (ptr) padded<T>{T(args...)};
+            }
+            catch (...)
+            {
+               a.deallocate(ptr, 1);
+               throw;
+            }
+            slots_.push_back({ptr, o});
+         }
+
+         size_t size() const { return slots_.size(); }
+
+         T& operator[](size_t i) { return slots_[i].ptr->value; }
+         const T& operator[](size_t i) const { return slots_[i].ptr->value; }
+
+     private:
+         struct slot
+         {
+            padded<T>* ptr;
+            hwlocxx::topology::object obj;
+         };
+
+         hwlocxx::topology topo_;
+         std::vector<slot> slots_;
+      };
+   } // namespace detail
+
+   /**
+    * One T per PU of an execution resource.
+    *
+    * Each slot lives on the NUMA node of its PU and takes a whole cache
+    * line, so workers can update their own slot without false sharing.
+    * Slots are indexed by the logical index of the PU, and local() gives
+    * the slot of the worker running the calling task.
+    */
+   template <typename T>
+   class per_pu
+   {
+  public:
+      template <typename... Args>
+      explicit per_pu(const thread_execution_resource_t& eR,
+                      const Args&... args)
+          : slots_{*eR.get_object().get_topo()}
+      {
+         auto root = eR.get_object();
+         auto pus = root.get_topo()->get_objects_inside(root.get_cpuset(),
+                                                        HWLOC_OBJ_PU);
+         // PUs below an object have consecutive logical indexes
+         first_ = pus.empty() ? 0 : pus.front().get_logical_index();
+         for (auto& pu : pus) {
+            slots_.emplace_back(pu, args...);
+         }
+      }
+
+      size_t size() const { return slots_.size(); }
+
+      T& operator[](int logicalIndex) { return slots_[slot(logicalIndex)]; }
+      const T& operator[](int logicalIndex) const
+      {
+         return slots_[slot(logicalIndex)];
+      }
+
+      /* Slot of the PU the calling worker is pinned to. Only valid from
+       * a worker running on a PU of the resource.
+       */
+      T& local() { return (*this)[this_thread::get_logical_pu()]; }
+
+      template <typename Function>
+      void for_each(Function&& func)
+      {
+         for (size_t i = 0; i < slots_.size(); i++) {
+            func(slots_[i]);
+         }
+      }
+
+  private:
+      size_t slot(int logicalIndex) const
+      {
+         Expects(logicalIndex >= first_
+                 && static_cast<size_t>(logicalIndex - first_)
+                        < slots_.size());
+         return static_cast<size_t>(logicalIndex - first_);
+      }
+
+      detail::local_slots<T> slots_;
+      int first_{0};
+   };
+
+   /**
+    * One T per NUMA node local to an execution resource.
+    *
+    * Slots are indexed by the logical index of the NUMA node, and local()
+    * gives the slot of the node of the worker running the calling task.
+    * All the workers of a node share its slot, so T must be safe to use
+    * from several threads at once (e.g. an atomic).
+    */
+   template <typename T>
+   class per_numa
+   {
+  public:
+      template <typename... Args>
+      explicit per_numa(const thread_execution_resource_t& eR,
+                        const Args&... args)
+          : slots_{*eR.get_object().get_topo()}
+      {
+         auto root = eR.get_object();
+         const auto* topo = root.get_topo().get();
+         const auto nodeset = root.get_nodeset();
+         const int numNodes = topo->get_width_by_type(HWLOC_OBJ_NUMANODE);
+         nodeSlot_.assign(numNodes, -1);
+         for (int i = 0; i < numNodes; i++) {
+            auto node = topo->get_object_by_type(HWLOC_OBJ_NUMANODE, i);
+            if (nodeset.is_set(node.get_os_index())) {
+               nodeSlot_[i] = static_cast<int>(slots_.size());
+               slots_.emplace_back(node, args...);
+            }
+         }
+
+         auto pus = topo->get_objects_inside(root.get_cpuset(), HWLOC_OBJ_PU);
+         firstPU_ = pus.empty() ? 0 : pus.front().get_logical_index();
+         for (auto& pu : pus) {
+            auto node =
+                hwloc_get_obj_by_type(topo->get(), HWLOC_OBJ_NUMANODE, 0);
+            while (node && !hwloc_bitmap_isset(pu.get()->nodeset,
+                                               node->os_index)) {
+               node = node->next_cousin;
+            }
+            puSlot_.push_back(node ? nodeSlot_[node->logical_index] : 0);
+         }
+      }
+
+      size_t size() const { return slots_.size(); }
+
+      T& operator[](int logicalIndex) { return slots_[slot(logicalIndex)]; }
+      const T& operator[](int logicalIndex) const
+      {
+         return slots_[slot(logicalIndex)];
+      }
+
+      /* Slot of the NUMA node of the PU the calling worker is pinned to.
+       * Only valid from a worker running on a PU of the resource.
+       */
+      T& local()
+      {
+         const int pu = this_thread::get_logical_pu() - firstPU_;
+         Expects(pu >= 0 && static_cast<size_t>(pu) < puSlot_.size());
+         return slots_[puSlot_[pu]];
+      }
+
+      template <typename Function>
+      void for_each(Function&& func)
+      {
+         for (size_t i = 0; i < slots_.size(); i++) {
+            func(slots_[i]);
+         }
+      }
+
+  private:
+      /* Slot of a NUMA node, which must be local to the resource */
+      size_t slot(int logicalIndex) const
+      {
+         Expects(logicalIndex >= 0
+                 && static_cast<size_t>(logicalIndex) < nodeSlot_.size()
+                 && nodeSlot_[logicalIndex] >= 0);
+         return static_cast<size_t>(nodeSlot_[logicalIndex]);
+      }
+
+      detail::local_slots<T> slots_;
+      // Slot of each NUMA node, by logical index (-1 if not local)
+      std::vector<int> nodeSlot_;
+      // Slot of the NUMA node of each PU, by PU logical index
+      std::vector<int> puSlot_;
+      int firstPU_{0};
+   };
+
+} // namespace experimental
+} // namespace hwlocxx
+#endif // HWLOCXX_PER_RESOURCE_HPP
@@ -0,0 +1,101 @@
+/**
+  Copyright 2017 Ruyman Reyes
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  File: io_locality.cpp : Threads and buffers next to NICs and NVMe drives
+
+  Usage: io_locality [--xml file] [device...]
+
+*/
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Include the Hwloc C++ wrapper
+#include <hwlocxx>
+
+int main(int argc, char* argv[])
+{
+   int first = 1;
+   std::unique_ptr<hwlocxx::topology> topo;
+   const auto filters = hwlocxx::topology::filters::with_io();
+   if (argc > 2 && std::string{argv[1]} == "--xml") {
+      topo = std::make_unique<hwlocxx::topology>(
+          hwlocxx::topology::xml{argv[2]}, filters);
+      first = 3;
+   }
+   else {
+      topo = std::make_unique<hwlocxx::topology>(filters);
+   }
+
+   std::vector<std::string> devices{argv + first, argv + argc};
+   if (devices.empty()) {
+      hwloc_obj_t o = nullptr;
+      while ((o = hwloc_get_next_osdev(topo->get(), o))) {
+         devices.emplace_back(o->name);
+      }
+   }
+
+   int errors = 0;
+   for (const auto& device : devices) {
+      auto eR = hwlocxx::experimental::device_resource(*topo, device);
+      // Bitmaps print their own end of line
+      std::cout << device << ": " << eR.get_object() << std::endl;
+      std::cout << " cpuset " << eR.get_object().get_cpuset();
+      std::cout << " nodeset " << eR.get_object().get_nodeset();
+
+      /* Buffers and threads local to the device */
+      auto a = hwlocxx::experimental::device_allocator<char>(*topo, device);
+      std::vector<char, hwlocxx::allocator<char>> buffer(4096u, 0, a);
+
+      hwlocxx::experimental::device_context eC{
+          *topo, device, hwlocxx::experimental::idle_policy::blocking()};
+      namespace this_thread = hwlocxx::experimental::this_thread;
+      auto pu = eC.executor()
+                    .twoway_execute([&]() -> unsigned {
+                       return static_cast<unsigned>(
+                           this_thread::get_logical_pu());
+                    })
+                    .get();
+      auto puObj = topo->get_object_by_type(HWLOC_OBJ_PU, pu);
+      std::cout << " worker on PU " << puObj.get_os_index() << std::endl;
+      errors += puObj.in_subtree(eR.get_object()) ? 0 : 1;
+   }
+
+   // Unknown devices are reported
+   try
+   {
+      hwlocxx::experimental::device_resource(*topo, "no-such-device");
+      errors++;
+   }
+   catch (const std::invalid_argument&)
+   {
+   }
+
+   // Without I/O objects no device can be found
+   if (argc > 2 && std::string{argv[1]} == "--xml") {
+      hwlocxx::topology noIO{hwlocxx::topology::xml{argv[2]}};
+      errors += (noIO.get_os_device("eth0")) ? 1 : 0;
+
+      // The fixture has a NIC on the first package, a drive on the second
+      auto eth = hwlocxx::experimental::device_resource(*topo, "eth0");
+      auto nvme = hwlocxx::experimental::device_resource(*topo, "nvme0n1");
+      errors += (eth.get_object().get_nodeset().first() == 0) ? 0 : 1;
+      errors += (nvme.get_object().get_nodeset().first() == 1) ? 0 : 1;
+   }
+
+   return errors;
+}
@@ -48,6 +48,26 @@ int main()
       }
    }
 
+   /* Example:
+    *    Cpusets are plain values: one index per PU of the machine
+    */
+   auto machineSet = topo.get_obj(0, 0).get_cpuset();
+   auto firstPU = machineSet;
+   firstPU &= topo.get_object_by_type(HWLOC_OBJ_PU, 0).get_cpuset();
+   auto otherPUs = machineSet.and_not(firstPU);
+   if (machineSet.weight() != topo.get_width_by_type(HWLOC_OBJ_PU)
+       || otherPUs.weight() != machineSet.weight() - 1
+       || (otherPUs | firstPU) != machineSet) {
+      return 1;
+   }
+   // Results of hwloc do not overwrite a set handed to it
+   auto held = firstPU.as_hwloc();
+   topo.get_cpubind(hwlocxx::cpubind::thread);
+   if (hwloc_bitmap_weight(held) != 1
+       || !hwloc_bitmap_isset(held, static_cast<unsigned>(firstPU.first()))) {
+      return 1;
+   }
+
    /* Example:
     *    Use the hwlocxx allocator to allocate storage for a vector
     */
@@ -60,5 +80,53 @@ int main()
    std::iota(std::begin(v1), std::end(v1), 1);
    auto sum = std::accumulate(std::begin(v1), std::end(v1), 0, std::plus<>());
    auto sumResult = (nElems * (nElems + 1) / 2);
-   return static_cast<int>(sumResult - sum);
+   if (sumResult != static_cast<size_t>(sum)) {
+      return 1;
+   }
+
+   /* Example:
+    *    The registry follows the allocator buffers pages are moved out of,
+    *    and never records other memory
+    */
+   auto& regions = hwlocxx::memory_regions::instance();
+   hwlocxx::bitmap elsewhere;
+   elsewhere.set(63u);
+   regions.update(v1.data() + 2, 4 * sizeof(int), elsewhere);
+   int onStack = 0;
+   regions.update(&onStack, sizeof(onStack), elsewhere);
+   if (regions.resolve(topo, v1.data()) != obj.get_nodeset()
+       || regions.resolve(topo, v1.data() + 3) != elsewhere
+       || regions.resolve(topo, v1.data() + 8) != obj.get_nodeset()
+       || regions.resolve(topo, &onStack) == elsewhere) {
+      return 1;
+   }
+   regions.update(v1.data(), nElems * sizeof(int), obj.get_nodeset());
+
+   /* Example:
+    *    Move the pages of a buffer to the NUMA node of the allocator,
+    *    in the background on the workers of an execution context
+    */
+   hwlocxx::experimental::thread_execution_resource_t machine{
+       topo.get_obj(0, 0)};
+   hwlocxx::experimental::ExecutionContext eC{machine};
+   std::vector<char> buffer(8u << 20, 1);
+   auto moved = hwlocxx::experimental::migrate(
+       eC.executor(), buffer.data(), buffer.size(), obj, 1u << 20);
+   try
+   {
+      moved.get();
+   }
+   catch (const std::system_error& e)
+   {
+      // Page migration may not be allowed here (e.g. in containers)
+      std::cout << "Migration not possible: " << e.what() << std::endl;
+      return 0;
+   }
+
+   auto residency = hwlocxx::experimental::get_residency(topo, buffer.data(),
+                                                         buffer.size());
+   const auto onNode = residency.fraction_on(obj.get_nodeset());
+   std::cout << "Pages on node " << obj.get_os_index() << ": "
+             << onNode.value_or(0.0) * 100 << "%" << std::endl;
+   return (onNode == 1.0) ? 0 : 1;
 }
@@ -13,13 +13,797 @@
   limitations under the License.
 */
 
+#include <fstream>
+#include <string>
+
 #include <hwlocxx>
 
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 namespace hwlocxx
 {
 namespace experimental
 {
-   void locality_executor::prepare_thread() { eC_.place_thread(); }
+   namespace
+   {
+#if defined(__linux__)
+      /* CPUs the cpuset cgroup of the process allows (cgroup v2, then
+       * v1), or an empty set if it cannot be read
+       */
+      bitmap cgroup_cpus()
+      {
+         std::ifstream cgroups{"/proc/self/cgroup"};
+         std::string line;
+         while (std::getline(cgroups, line)) {
+            // hierarchy-ID:controllers:path, no controllers on v2
+            const auto first = line.find(':');
+            const auto second = line.find(':', first + 1);
+            if (first == std::string::npos || second == std::string::npos) {
+               continue;
+            }
+            const auto controllers =
+                "," + line.substr(first + 1, second - first - 1) + ",";
+            const auto path = line.substr(second + 1);
+            std::vector<std::string> files;
+            if (controllers == ",,") {
+               files = {"/sys/fs/cgroup" + path + "/cpuset.cpus.effective"};
+            }
+            else if (controllers.find(",cpuset,") != std::string::npos) {
+               files = {"/sys/fs/cgroup/cpuset" + path
+                            + "/cpuset.effective_cpus",
+                        "/sys/fs/cgroup/cpuset" + path + "/cpuset.cpus"};
+            }
+            for (const auto& file : files) {
+               std::ifstream in{file};
+               std::string list;
+               auto cpus = bitmap::scratch(bitmap::scratch_slot::output);
+               if (in >> list
+                   && hwloc_bitmap_list_sscanf(cpus, list.c_str()) == 0
+                   && !hwloc_bitmap_iszero(cpus)) {
+                  return bitmap{cpus};
+               }
+            }
+         }
+         return {};
+      }
+#endif
+
+      /**
+       * CPUs the process may currently run on. The binding of the process
+       * cannot be used: on Linux it is the union of the bindings of its
+       * threads, including the workers a context pinned itself, so it
+       * would never grow back after a shrink.
+       */
+      bitmap allowed_cpus(const topology& topo)
+      {
+         if (!topo.is_thissystem()) {
+            // Stubbed, see topology::set_cpubind()
+            return topo.get_cpubind(cpubind::process);
+         }
+#if defined(__linux__)
+         auto cpus = cgroup_cpus();
+         if (!cpus.empty()) {
+            return cpus;
+         }
+#endif
+         // Loading the topology again reads the allowed set afresh
+         topology fresh;
+         return bitmap{hwloc_topology_get_allowed_cpuset(fresh.get())};
+      }
+   } // namespace
+
+   ExecutionContext::ExecutionContext(execution_resource_t& eR,
+                                      idle_policy policy)
+       : topo_{eR.get_object().get_topo()}, eR_{eR}, policy_{policy},
+         cost_{*topo_}
+   {
+      auto pus = topo_->get_objects_inside(eR.get_object().get_cpuset(),
+                                           HWLOC_OBJ_PU);
+      coreBusy_ = std::make_unique<detail::padded<std::atomic<unsigned>>[]>(
+          pus.size());
+
+      // PUs sharing a core share a busy counter, topologies without cores
+      // get one counter per PU
+      std::vector<int> coreSlot(pus.size(), -1);
+      std::vector<size_t> slotOf;
+      size_t cores = 0;
+      for (auto& pu : pus) {
+         auto w = std::make_unique<detail::worker>(pu, workers_.size());
+         auto core = hwloc_get_ancestor_obj_by_type(
+             topo_->get(), HWLOC_OBJ_CORE, pu.get());
+         size_t slot = cores;
+         if (core) {
+            if (static_cast<size_t>(core->logical_index) >= coreSlot.size()) {
+               coreSlot.resize(core->logical_index + 1, -1);
+            }
+            if (coreSlot[core->logical_index] < 0) {
+               coreSlot[core->logical_index] = static_cast<int>(cores++);
+            }
+            slot = coreSlot[core->logical_index];
+         }
+         else {
+            cores++;
+         }
+         slotOf.push_back(slot);
+         w->spinBudget_ = policy_.spin;
+         workers_.push_back(std::move(w));
+      }
+
+      // The counters are only read by spinning workers backing off for
+      // a sibling, so nothing is counted when none can do it
+      std::vector<unsigned> slotWorkers(cores, 0u);
+      for (auto slot : slotOf) {
+         slotWorkers[slot]++;
+      }
+      const bool backOff =
+          policy_.max_spin > 0 && policy_.sibling_busy_divisor > 1;
+      for (size_t id = 0; id < workers_.size(); id++) {
+         if (backOff && slotWorkers[slotOf[id]] > 1) {
+            workers_[id]->coreBusy_ = &coreBusy_[slotOf[id]].value;
+         }
+      }
+      refresh();
+   }
+
+   ExecutionContext::~ExecutionContext()
+   {
+      for (auto& w : workers_) {
+         {
+            std::lock_guard<std::mutex> lock{w->m_};
+            w->stop_ = true;
+         }
+         w->cv_.notify_one();
+      }
+      for (auto& w : workers_) {
+         if (w->thread_.joinable()) {
+            w->thread_.join();
+         }
+      }
+   }
+
+   bool ExecutionContext::refresh()
+   {
+      std::lock_guard<std::mutex> lock{refreshM_};
+
+      // Run on the PUs of the resource the process is allowed to use
+      const auto resourceSet = eR_.get_object().get_cpuset();
+      auto partition = resourceSet & allowed_cpus(*topo_);
+      if (partition.empty()) {
+         partition = resourceSet;
+      }
+
+      const auto current = std::atomic_load(&placement_);
+      if (current && current->partition_ == partition) {
+         return false;
+      }
+      publish(partition);
+      return true;
+   }
+
+   void ExecutionContext::reserve(const bitmap& cpuset)
+   {
+      std::lock_guard<std::mutex> lock{refreshM_};
+      reserved_ = cpuset;
+      publish(std::atomic_load(&placement_)->partition_);
+   }
+
+   void ExecutionContext::publish(const bitmap& partition)
+   {
+      // Generations of all the contexts of the process
+      static std::atomic<std::uint64_t> generations{0};
+
+      auto next = std::make_shared<detail::placement>();
+      next->generation_ = ++generations;
+      next->partition_ = partition;
+      next->reserved_ = reserved_ & partition;
+      for (size_t id = 0; id < workers_.size(); id++) {
+         const auto os = workers_[id]->pu_.get_os_index();
+         if (!partition.is_set(os)) {
+            continue;
+         }
+         next->active_.push_back(id);
+         if (next->reserved_.is_set(os)) {
+            next->latency_.push_back(id);
+         }
+         else {
+            next->batch_.push_back(id);
+         }
+      }
+      // Without reservation (or without anything left to batch work)
+      // both classes share all the workers
+      if (next->latency_.empty()) {
+         next->latency_ = next->active_;
+      }
+      if (next->batch_.empty()) {
+         next->batch_ = next->active_;
+      }
+
+      next->nodeLatency_ = workers_by_node(next->latency_);
+      next->nodeBatch_ = workers_by_node(next->batch_);
+
+      const auto generation = next->generation_;
+      std::atomic_store(&placement_,
+                        std::shared_ptr<const detail::placement>{next});
+      generation_.store(generation, std::memory_order_release);
+
+      for (auto& w : workers_) {
+         if (!w->thread_.joinable()) {
+            if (partition.is_set(w->pu_.get_os_index())) {
+               w->thread_ = std::thread([this, &w = *w]() { run_worker(w); });
+            }
+            continue;
+         }
+         // Wake idle workers so they move to their new binding
+         {
+            std::lock_guard<std::mutex> wLock{w->m_};
+         }
+         w->cv_.notify_one();
+      }
+   }
+
+   std::vector<std::vector<size_t>>
+   ExecutionContext::workers_by_node(const std::vector<size_t>& ids) const
+   {
+      std::vector<std::vector<size_t>> nodeWorkers;
+      for (auto id : ids) {
+         auto nodeset = workers_[id]->pu_.get_nodeset();
+         for (int n = nodeset.first(); n != -1; n = nodeset.next(n)) {
+            if (nodeWorkers.size() <= static_cast<size_t>(n)) {
+               nodeWorkers.resize(n + 1);
+            }
+            nodeWorkers[n].push_back(id);
+         }
+      }
+
+      bitmap served;
+      for (size_t n = 0; n < nodeWorkers.size(); n++) {
+         if (!nodeWorkers[n].empty()) {
+            served.set(static_cast<unsigned>(n));
+         }
+      }
+      const int numNodes = topo_->get_width_by_type(HWLOC_OBJ_NUMANODE);
+      for (int i = 0; i < numNodes && !served.empty(); i++) {
+         const auto n = static_cast<size_t>(
+             topo_->get_object_by_type(HWLOC_OBJ_NUMANODE, i).get_os_index());
+         if (nodeWorkers.size() <= n) {
+            nodeWorkers.resize(n + 1);
+         }
+         if (nodeWorkers[n].empty()) {
+            bitmap node;
+            node.set(static_cast<unsigned>(n));
+            nodeWorkers[n] = nodeWorkers[cost_.closest(node, served)];
+         }
+      }
+      return nodeWorkers;
+   }
+
+   const detail::placement& ExecutionContext::current_placement() const
+   {
+      struct cached
+      {
+         std::uint64_t generation{0};
+         std::shared_ptr<const detail::placement> p;
+      };
+      // Last placements used by this thread, generations being unique in
+      // the process. Only a change of placement goes through the atomic
+      // shared_ptr.
+      static thread_local std::array<cached, 4> cache;
+
+      const auto generation = generation_.load(std::memory_order_acquire);
+      auto& slot = cache[generation % cache.size()];
+      if (slot.generation != generation) {
+         slot.p = std::atomic_load(&placement_);
+         slot.generation = slot.p->generation_;
+      }
+      return *slot.p;
+   }
+
+   void ExecutionContext::place_thread(const detail::worker& w,
+                                       const detail::placement& p)
+   {
+      // Workers whose PU was taken away share the remaining ones
+      const auto& pu = w.pu_;
+      if (p.partition_.is_set(pu.get_os_index())) {
+         get_topology().set_cpubind(pu.get_cpuset(), cpubind::thread);
+      }
+      else {
+         get_topology().set_cpubind(p.partition_, cpubind::thread);
+      }
+      this_thread::detail::logicalPU = pu.get_logical_index();
+      this_thread::detail::worker = &w;
+   }
+
+   namespace
+   {
+      /* Next task of a worker, latency lane first. Requires w.m_. */
+      bool pop_locked(detail::worker& w, detail::task& t)
+      {
+         auto& lane = w.latency_.empty() ? w.batch_ : w.latency_;
+         if (lane.empty()) {
+            return false;
+         }
+         t = std::move(lane.front());
+         lane.pop_front();
+         w.update_queued();
+         return true;
+      }
+
+      bool pop(detail::worker& w, detail::task& t)
+      {
+         std::lock_guard<std::mutex> lock{w.m_};
+         return pop_locked(w, t);
+      }
+   } // namespace
+
+   void ExecutionContext::run_worker(detail::worker& w)
+   {
+      std::uint64_t placed = 0;
+      std::shared_ptr<const detail::placement> p;
+      bool reserved = false;
+      for (;;) {
+         const auto gen = generation_.load();
+         if (gen != placed) {
+            p = std::atomic_load(&placement_);
+            place_thread(w, *p);
+            reserved = p->reserved_.is_set(w.pu_.get_os_index());
+            placed = gen;
+         }
+
+         // Own work first: a reserved worker only borrows batch work when
+         // it has no latency work, and only one task at a time
+         detail::task t;
+         bool found = pop(w, t);
+         if (!found && reserved) {
+            // Announced before the last look, so batch submissions poke us
+            idleReserved_++;
+            found = borrow(*p, t);
+            if (found) {
+               idleReserved_--;
+               detail::bump(w.borrowed_);
+            }
+         }
+
+         if (!found) {
+            const bool keepGoing = wait_for_work(w, placed);
+            if (reserved) {
+               idleReserved_--;
+            }
+            if (!keepGoing) {
+               return;
+            }
+            continue;
+         }
+
+         if (w.coreBusy_) {
+            w.coreBusy_->fetch_add(1, std::memory_order_relaxed);
+         }
+         t();
+         if (w.coreBusy_) {
+            w.coreBusy_->fetch_sub(1, std::memory_order_relaxed);
+         }
+         detail::bump(w.tasks_);
+      }
+   }
+
+   bool ExecutionContext::wait_for_work(detail::worker& w,
+                                        std::uint64_t placed)
+   {
+      auto ready = [&]() {
+         // Only write poked_ when it is set, so spinning does not keep
+         // its cache line busy
+         return w.queued_.load(std::memory_order_acquire) > 0
+                || (w.poked_.load(std::memory_order_relaxed)
+                    && w.poked_.exchange(false))
+                || generation_.load() != placed;
+      };
+      auto adapt = [&](bool soon) {
+         if (!policy_.adaptive) {
+            return;
+         }
+         w.spinBudget_ = soon ? std::min(policy_.max_spin,
+                                         std::max(w.spinBudget_, 1u) * 2)
+                              : std::max(policy_.min_spin, w.spinBudget_ / 2);
+      };
+
+      // Spin, backing off sooner while an SMT sibling is running a task
+      const auto siblingBudget =
+          w.spinBudget_ / std::max(policy_.sibling_busy_divisor, 1u);
+      for (unsigned i = 0; i < w.spinBudget_; i++) {
+         if (ready()) {
+            adapt(true);
+            return true;
+         }
+         if (i >= siblingBudget && w.coreBusy_
+             && w.coreBusy_->load(std::memory_order_relaxed) > 0) {
+            break;
+         }
+         detail::cpu_relax();
+      }
+
+      for (unsigned i = 0; i < policy_.yields; i++) {
+         if (ready()) {
+            adapt(true);
+            return true;
+         }
+         std::this_thread::yield();
+      }
+
+      // Park
+      detail::bump(w.parks_);
+      const auto parked = std::chrono::steady_clock::now();
+      std::unique_lock<std::mutex> lock{w.m_};
+      w.sleeping_ = true;
+      w.cv_.wait(lock, [&]() {
+         return w.stop_ || w.has_work() || w.poked_.exchange(false)
+                || generation_.load() != placed;
+      });
+      w.sleeping_ = false;
+      // Pending tasks are drained before stopping
+      const bool stopping = w.stop_ && !w.has_work();
+      lock.unlock();
+      adapt(std::chrono::steady_clock::now() - parked < policy_.short_park);
+      return !stopping;
+   }
+
+   bool ExecutionContext::borrow(const detail::placement& p, detail::task& t)
+   {
+      const auto& lenders = p.batch_;
+      const size_t start = next_++;
+      for (size_t i = 0; i < lenders.size(); i++) {
+         auto& lender = *workers_[lenders[(start + i) % lenders.size()]];
+         std::unique_lock<std::mutex> lock{lender.m_, std::try_to_lock};
+         if (lock.owns_lock() && !lender.batch_.empty()) {
+            t = std::move(lender.batch_.front());
+            lender.batch_.pop_front();
+            lender.update_queued();
+            return true;
+         }
+      }
+      return false;
+   }
+
+   template <priority P>
+   void ExecutionContext::enqueue(size_t worker, detail::task t)
+   {
+      auto& w = *workers_[worker];
+      bool wake = false;
+      {
+         std::lock_guard<std::mutex> lock{w.m_};
+         if constexpr (P == priority::latency) {
+            w.latency_.push_back(std::move(t));
+         }
+         else {
+            w.batch_.push_back(std::move(t));
+         }
+         w.update_queued();
+         wake = w.sleeping_;
+      }
+      if (wake) {
+         w.cv_.notify_one();
+      }
+
+      if constexpr (P == priority::batch) {
+         offer_to_reserved();
+      }
+   }
+
+   template void ExecutionContext::enqueue<priority::batch>(size_t,
+                                                            detail::task);
+   template void ExecutionContext::enqueue<priority::latency>(size_t,
+                                                              detail::task);
+
+   void ExecutionContext::enqueue_batch(std::vector<detail::task> tasks,
+                                        size_t grain)
+   {
+      const size_t n = tasks.size();
+      if (n == 0) {
+         return;
+      }
+      const auto& targets = current_placement().batch_;
+      grain = std::max<size_t>(grain, 1);
+      const size_t shares = std::min(targets.size(), (n + grain - 1) / grain);
+      const size_t start = next_.fetch_add(shares);
+
+      // Consecutive shares go to consecutive workers, so neighbouring
+      // tasks of the batch run on neighbouring PUs
+      auto it = std::make_move_iterator(tasks.begin());
+      for (size_t i = 0; i < shares; i++) {
+         const auto count =
+             static_cast<std::ptrdiff_t>(n / shares + (i < n % shares));
+         auto& w = *workers_[targets[(start + i) % targets.size()]];
+         bool wake = false;
+         {
+            std::lock_guard<std::mutex> lock{w.m_};
+            w.batch_.insert(w.batch_.end(), it, it + count);
+            w.update_queued();
+            wake = w.sleeping_;
+         }
+         if (wake) {
+            w.cv_.notify_one();
+         }
+         it += count;
+      }
+
+      offer_to_reserved();
+   }
+
+   size_t ExecutionContext::batch_grain(size_t n, size_t grain) const
+   {
+      if (grain > 0) {
+         return grain;
+      }
+      // One share per batch worker, but no share so small that waking a
+      // worker for it costs more than running it
+      const auto width = std::max<size_t>(batch_width(), 1);
+      return std::max(min_share, (n + width - 1) / width);
+   }
+
+   void ExecutionContext::offer_to_reserved()
+   {
+      if (idleReserved_.load() == 0) {
+         return;
+      }
+      const auto& current = current_placement();
+      if (current.reserved_.empty()) {
+         return;
+      }
+      const auto& lanes = current.latency_;
+      auto& r = *workers_[lanes[next_++ % lanes.size()]];
+      {
+         std::lock_guard<std::mutex> lock{r.m_};
+         r.poked_ = true;
+         if (!r.sleeping_) {
+            return;
+         }
+      }
+      r.cv_.notify_one();
+   }
+
+   template <priority P>
+   size_t ExecutionContext::next_worker()
+   {
+      const auto& current = current_placement();
+      const auto& candidates =
+          (P == priority::latency) ? current.latency_ : current.batch_;
+      return candidates[next_++ % candidates.size()];
+   }
+
+   template size_t ExecutionContext::next_worker<priority::batch>();
+   template size_t ExecutionContext::next_worker<priority::latency>();
+
+   template <priority P>
+   size_t ExecutionContext::worker_near(const void* ptr)
+   {
+      auto nodeset =
+          memory_regions::instance().resolve(get_topology(), ptr);
+      const auto& p = current_placement();
+      const auto& byNode =
+          (P == priority::latency) ? p.nodeLatency_ : p.nodeBatch_;
+      for (int n = nodeset.first(); n != -1; n = nodeset.next(n)) {
+         if (static_cast<size_t>(n) < byNode.size() && !byNode[n].empty()) {
+            const auto& local = byNode[n];
+            return local[next_++ % local.size()];
+         }
+      }
+      const auto& any = (P == priority::latency) ? p.latency_ : p.batch_;
+      return any[next_++ % any.size()];
+   }
+
+   template size_t
+   ExecutionContext::worker_near<priority::batch>(const void*);
+   template size_t
+   ExecutionContext::worker_near<priority::latency>(const void*);
+
+   metrics_snapshot ExecutionContext::metrics() const
+   {
+      metrics_snapshot m;
+      m.taken_at = std::chrono::steady_clock::now();
+      m.workers.reserve(workers_.size());
+      for (const auto& w : workers_) {
+         m.workers.push_back({w->pu_.get_logical_index(),
+                              w->tasks_.load(std::memory_order_relaxed),
+                              w->borrowed_.load(std::memory_order_relaxed),
+                              w->parks_.load(std::memory_order_relaxed),
+                              w->queued_.load(std::memory_order_relaxed)});
+      }
+      if (auto locality = std::atomic_load(&locality_)) {
+         m.buffers = *locality;
+      }
+      return m;
+   }
+
+   std::optional<size_t> ExecutionContext::current_worker() const noexcept
+   {
+      const auto* w =
+          static_cast<const detail::worker*>(this_thread::detail::worker);
+      if (w && w->id_ < workers_.size() && workers_[w->id_].get() == w) {
+         return w->id_;
+      }
+      return std::nullopt;
+   }
+
+   size_t ExecutionContext::batch_width() const
+   {
+      return current_placement().batch_.size();
+   }
+
+   void ExecutionContext::work_started() noexcept
+   {
+      outstanding_.fetch_add(1, std::memory_order_relaxed);
+   }
+
+   void ExecutionContext::work_finished() noexcept
+   {
+      if (outstanding_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+         std::lock_guard<std::mutex> lock{workM_};
+         workCv_.notify_all();
+      }
+   }
+
+   void ExecutionContext::wait()
+   {
+      std::unique_lock<std::mutex> lock{workM_};
+      workCv_.wait(lock, [this]() { return outstanding_.load() == 0; });
+   }
+
+   thread_execution_resource_t device_resource(const topology& topo,
+                                               const std::string& device)
+   {
+      auto dev = topo.get_os_device(device);
+      if (!dev) {
+         throw std::invalid_argument{"hwlocxx: no such device: " + device};
+      }
+      return thread_execution_resource_t{dev->get_non_io_ancestor()};
+   }
+
+   device_context::device_context(const topology& topo,
+                                  const std::string& device,
+                                  idle_policy policy)
+       : detail::device_resource_holder{device_resource(topo, device)},
+         ExecutionContext{deviceResource_, policy}
+   {
+   }
+
+   bitmap first_in_each(const hwlocxx::topology::object& root,
+                        hwloc_obj_type_t group, hwloc_obj_type_t member)
+   {
+      const auto* topo = root.get_topo().get();
+      bitmap ret;
+      for (auto& g : topo->get_objects_inside(root.get_cpuset(), group)) {
+         auto members = topo->get_objects_inside(g.get_cpuset(), member);
+         if (!members.empty()) {
+            ret |= members.front().get_cpuset();
+         }
+      }
+      return ret;
+   }
+
+   cpuset_watcher::cpuset_watcher(ExecutionContext& eC,
+                                  std::chrono::milliseconds period)
+       : eC_{eC}, period_{period}
+   {
+      thread_ = std::thread([this]() {
+         std::unique_lock<std::mutex> lock{m_};
+         while (!cv_.wait_for(lock, period_, [this]() { return stop_; })) {
+            lock.unlock();
+            eC_.refresh();
+            lock.lock();
+         }
+      });
+   }
+
+   cpuset_watcher::~cpuset_watcher()
+   {
+      {
+         std::lock_guard<std::mutex> lock{m_};
+         stop_ = true;
+      }
+      cv_.notify_one();
+      thread_.join();
+   }
+
+   locality_auditor::locality_auditor(ExecutionContext& eC,
+                                      std::chrono::milliseconds period,
+                                      size_t stride)
+       : eC_{eC}, period_{period}, stride_{stride}
+   {
+      thread_ = std::thread([this]() {
+         auto topo = eC_.get_topology();
+         auto root = eC_.execution_resource().get_object();
+         auto pus = topo.get_objects_inside(root.get_cpuset(), HWLOC_OBJ_PU);
+         if (!pus.empty()) {
+            topo.set_cpubind(pus.back().get_cpuset(), cpubind::thread);
+         }
+#if defined(__linux__) && defined(SCHED_IDLE)
+         // Best effort: only runs when the PU has nothing else to do
+         sched_param param{};
+         pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+#endif
+
+         std::unique_lock<std::mutex> lock{m_};
+         while (!cv_.wait_for(lock, period_, [this]() { return stop_; })) {
+            sample_locked();
+         }
+      });
+   }
+
+   locality_auditor::~locality_auditor()
+   {
+      {
+         std::lock_guard<std::mutex> lock{m_};
+         stop_ = true;
+      }
+      cv_.notify_one();
+      thread_.join();
+   }
+
+   void locality_auditor::watch(std::string name, const void* ptr, size_t len)
+   {
+      watch(std::move(name), ptr, len,
+            eC_.execution_resource().get_object().get_nodeset());
+   }
+
+   void locality_auditor::watch(std::string name, const void* ptr, size_t len,
+                                const bitmap& nodeset)
+   {
+      std::lock_guard<std::mutex> lock{m_};
+      buffers_.push_back({std::move(name), ptr, len, nodeset});
+   }
+
+   void locality_auditor::unwatch(const void* ptr)
+   {
+      std::lock_guard<std::mutex> lock{m_};
+      buffers_.erase(std::remove_if(buffers_.begin(), buffers_.end(),
+                                    [ptr](const watched& b) {
+                                       return b.ptr == ptr;
+                                    }),
+                     buffers_.end());
+
+      // Do not report buffers that may be gone
+      if (auto published = std::atomic_load(&eC_.locality_)) {
+         auto kept = std::make_shared<std::vector<buffer_locality>>();
+         for (const auto& b : *published) {
+            if (b.address != ptr) {
+               kept->push_back(b);
+            }
+         }
+         std::atomic_store(
+             &eC_.locality_,
+             std::shared_ptr<const std::vector<buffer_locality>>{kept});
+      }
+   }
+
+   void locality_auditor::sample()
+   {
+      std::lock_guard<std::mutex> lock{m_};
+      sample_locked();
+   }
+
+   void locality_auditor::sample_locked()
+   {
+      const auto topo = eC_.get_topology();
+      auto results = std::make_shared<std::vector<buffer_locality>>();
+      results->reserve(buffers_.size());
+      for (const auto& b : buffers_) {
+         auto residency = get_residency(topo, b.ptr, b.len, stride_);
+         size_t local = 0;
+         for (int n : b.expected) {
+            if (static_cast<size_t>(n) < residency.pages.size()) {
+               local += residency.pages[n];
+            }
+         }
+         results->push_back({b.name, b.ptr, b.len, b.expected,
+                             residency.sampled, residency.unmapped, local,
+                             residency.fraction_on(b.expected),
+                             std::chrono::steady_clock::now()});
+      }
+      std::atomic_store(
+          &eC_.locality_,
+          std::shared_ptr<const std::vector<buffer_locality>>{results});
+   }
 
     namespace this_system
     {
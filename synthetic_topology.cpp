@@ -0,0 +1,333 @@
+/**
+  Copyright 2017 Ruyman Reyes
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  File: synthetic_topology.cpp : Placement and partitioning at the scale of
+  a large machine, on a synthetic or XML topology.
+
+  Usage: synthetic_topology [description | --xml file]
+
+*/
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Include the Hwloc C++ wrapper
+#include <hwlocxx>
+
+template <typename Function>
+double time_ms(Function&& func)
+{
+   auto start = std::chrono::steady_clock::now();
+   func();
+   std::chrono::duration<double, std::milli> elapsed =
+       std::chrono::steady_clock::now() - start;
+   return elapsed.count();
+}
+
+int main(int argc, char* argv[])
+{
+   std::string description = "pack:8 numa:2 l3:1 core:16 pu:2";
+   std::unique_ptr<hwlocxx::topology> topo;
+
+   auto loadTime = time_ms([&]() {
+      if (argc > 2 && std::string{argv[1]} == "--xml") {
+         topo = std::make_unique<hwlocxx::topology>(
+             hwlocxx::topology::xml{argv[2]});
+      }
+      else {
+         if (argc > 1) {
+            description = argv[1];
+         }
+         topo = std::make_unique<hwlocxx::topology>(
+             hwlocxx::topology::synthetic{description});
+      }
+   });
+
+   int errors = topo->is_thissystem() ? 1 : 0;
+   const auto numPUs = topo->get_width_by_type(HWLOC_OBJ_PU);
+   std::cout << "Topology: " << description << std::endl;
+   std::cout << " PUs " << numPUs << " NUMA nodes "
+             << topo->get_width_by_type(HWLOC_OBJ_NUMANODE) << std::endl;
+   std::cout << " load: " << loadTime << " ms" << std::endl;
+
+   hwlocxx::experimental::thread_execution_resource_t machine{
+       topo->get_obj(0, 0)};
+
+   /* Placement: one worker per PU, all submissions round-robin */
+   const unsigned nTasks = 4096u;
+   double contextTime = 0.0;
+   double submitTime = 0.0;
+   double refreshTime = 0.0;
+   auto teardownTime = time_ms([&]() {
+      std::unique_ptr<hwlocxx::experimental::ExecutionContext> eC;
+      // Workers are not really pinned on a synthetic machine, so they
+      // must not spin against each other
+      contextTime = time_ms([&]() {
+         eC = std::make_unique<hwlocxx::experimental::ExecutionContext>(
+             machine, hwlocxx::experimental::idle_policy::blocking());
+      });
+
+      auto ex = eC->executor();
+      std::vector<std::future<unsigned>> futs;
+      futs.reserve(nTasks);
+      submitTime = time_ms([&]() {
+         for (unsigned i = 0; i < nTasks; i++) {
+            futs.push_back(ex.twoway_execute([]() -> unsigned {
+               return hwlocxx::experimental::this_thread::get_logical_pu() >= 0;
+            }));
+         }
+         for (auto& f : futs) {
+            errors += 1 - static_cast<int>(f.get());
+         }
+      });
+
+      std::atomic<unsigned> batchCount{0u};
+      std::vector<std::function<void()>> batch(nTasks,
+                                               [&]() { batchCount++; });
+      auto batchTime = time_ms([&]() { ex.execute_batch(batch).get(); });
+      errors += (batchCount.load() == nTasks) ? 0 : 1;
+      std::cout << " " << nTasks << " tasks in one batch: " << batchTime
+                << " ms" << std::endl;
+
+      // A batch smaller than a share runs on a single worker
+      std::mutex smallM;
+      hwlocxx::bitmap smallPUs;
+      std::vector<std::function<void()>> small(8u, [&]() {
+         std::lock_guard<std::mutex> lock{smallM};
+         smallPUs.set(static_cast<unsigned>(
+             hwlocxx::experimental::this_thread::get_logical_pu()));
+      });
+      ex.execute_batch(small).get();
+      errors += (smallPUs.weight() == 1) ? 0 : 1;
+
+      refreshTime = time_ms([&]() { errors += eC->refresh() ? 1 : 0; });
+
+      /* Latency lane on one SMT sibling per core, batch work on the rest */
+      auto reserved = hwlocxx::experimental::first_in_each(
+          machine.get_object(), HWLOC_OBJ_CORE);
+      eC->reserve(reserved);
+      futs.clear();
+      std::vector<std::future<unsigned>> latencyFuts;
+      auto lanesTime = time_ms([&]() {
+         for (unsigned i = 0; i < nTasks; i++) {
+            futs.push_back(ex.twoway_execute([]() -> unsigned { return 1u; }));
+            if (i % 8 == 0) {
+               latencyFuts.push_back(ex.twoway_execute(
+                   hwlocxx::experimental::priority::latency,
+                   [&]() -> unsigned {
+                      auto pu = topo->get_object_by_type(
+                          HWLOC_OBJ_PU,
+                          hwlocxx::experimental::this_thread::get_logical_pu());
+                      return reserved.is_set(pu.get_os_index());
+                   }));
+            }
+         }
+         // Latency work placed near data also stays on the reserved PUs
+         auto urgent = ex.require(
+             hwlocxx::experimental::execution::placement.latency);
+         for (unsigned i = 0; i < nTasks / 8; i++) {
+            latencyFuts.push_back(
+                urgent.twoway_execute_near(&reserved, [&]() -> unsigned {
+                   auto pu = topo->get_object_by_type(
+                       HWLOC_OBJ_PU,
+                       hwlocxx::experimental::this_thread::get_logical_pu());
+                   return reserved.is_set(pu.get_os_index());
+                }));
+         }
+         for (auto& f : futs) {
+            errors += 1 - static_cast<int>(f.get());
+         }
+         for (auto& f : latencyFuts) {
+            errors += 1 - static_cast<int>(f.get());
+         }
+      });
+      std::cout << " reserved PUs " << reserved.weight() << ", "
+                << latencyFuts.size() << " latency tasks among " << nTasks
+                << " batch: " << lanesTime << " ms" << std::endl;
+
+      /* Partition: the process loses all but its first package, then
+       * gets the whole machine back
+       */
+      eC->reserve(hwlocxx::bitmap{});
+      // PUs the tasks found their worker bound to
+      auto boundTo = [&]() {
+         hwlocxx::bitmap used;
+         futs.clear();
+         for (unsigned i = 0; i < nTasks; i++) {
+            futs.push_back(ex.twoway_execute([&]() -> unsigned {
+               return static_cast<unsigned>(
+                   topo->get_cpubind(hwlocxx::cpubind::thread).first());
+            }));
+         }
+         for (auto& f : futs) {
+            used.set(f.get());
+         }
+         return used;
+      };
+      const auto whole = machine.get_object().get_cpuset();
+      const auto package =
+          topo->get_object_by_type(HWLOC_OBJ_PACKAGE, 0).get_cpuset();
+      topo->set_cpubind(package, hwlocxx::cpubind::process);
+      errors += eC->refresh() ? 0 : 1;
+      auto used = boundTo();
+      errors += ((used & package) == used) ? 0 : 1;
+      topo->set_cpubind(whole, hwlocxx::cpubind::process);
+      errors += eC->refresh() ? 0 : 1;
+      used = boundTo();
+      errors += (whole == package || (used & package) != used) ? 0 : 1;
+      std::cout << " partition shrunk to " << package.weight()
+                << " PUs and grown back to " << whole.weight() << std::endl;
+   });
+   std::cout << " context: " << contextTime << " ms" << std::endl;
+   std::cout << " " << nTasks << " tasks: " << submitTime << " ms"
+             << std::endl;
+   std::cout << " refresh: " << refreshTime << " ms" << std::endl;
+   std::cout << " teardown: " << teardownTime << " ms" << std::endl;
+
+   /* Allocations on this topology are not recorded as living on its
+    * nodes, which do not exist on the machine running the test
+    */
+   {
+      const auto numNodes = topo->get_width_by_type(HWLOC_OBJ_NUMANODE);
+      auto fake = topo->get_object_by_type(HWLOC_OBJ_NUMANODE, numNodes - 1);
+      hwlocxx::allocator<double> a{*topo, fake};
+      std::vector<double, hwlocxx::allocator<double>> buffer(1024u, 1.0, a);
+      hwlocxx::topology system;
+      auto found =
+          hwlocxx::memory_regions::instance().resolve(system, buffer.data());
+      errors += (numNodes > 1 && found == fake.get_nodeset()) ? 1 : 0;
+   }
+
+   /* Partitioning: per-PU slots and topology-shaped reduction trees */
+   auto slotsTime = time_ms([&]() {
+      hwlocxx::experimental::per_pu<unsigned> slots{machine, 0u};
+      errors += (slots.size() == static_cast<size_t>(numPUs)) ? 0 : 1;
+   });
+   std::cout << " per_pu: " << slotsTime << " ms" << std::endl;
+
+   std::unique_ptr<hwlocxx::experimental::hierarchical_reduction<size_t>> sum;
+   auto treeTime = time_ms([&]() {
+      sum = std::make_unique<
+          hwlocxx::experimental::hierarchical_reduction<size_t>>(machine);
+   });
+   std::cout << " reduction tree: " << treeTime << " ms" << std::endl;
+
+   const size_t participants = sum->size();
+   const size_t rounds = 10u;
+   std::atomic<int> wrong{0};
+   auto reduceTime = time_ms([&]() {
+      std::vector<std::thread> threads;
+      for (size_t p = 0; p < participants; p++) {
+         threads.emplace_back([&, p]() {
+            for (size_t r = 0; r < rounds; r++) {
+               if (sum->reduce(p, 1u) != participants) {
+                  wrong++;
+               }
+            }
+         });
+      }
+      for (auto& t : threads) {
+         t.join();
+      }
+   });
+   std::cout << " " << rounds << " reductions: " << reduceTime << " ms"
+             << std::endl;
+
+   /* Distances: derived from the tree unless the topology provides them */
+   hwlocxx::experimental::placement_cost cost{*topo};
+   const auto& latency = cost.latency();
+   std::cout << " NUMA latencies ("
+             << (latency.measured() ? "measured" : "from the tree")
+             << "):" << std::endl;
+   for (size_t i = 0; i < latency.size() && i < 4; i++) {
+      std::cout << "  ";
+      for (size_t j = 0; j < latency.size() && j < 4; j++) {
+         std::cout << latency(i, j) << " ";
+         errors += (latency(i, j) == latency(j, i)) ? 0 : 1;
+         errors += (latency(i, j) >= latency(i, i)) ? 0 : 1;
+      }
+      std::cout << std::endl;
+   }
+
+   const auto numNodes = topo->get_width_by_type(HWLOC_OBJ_NUMANODE);
+   if (numNodes > 1) {
+      auto first = topo->get_object_by_type(HWLOC_OBJ_NUMANODE, 0);
+      auto last = topo->get_object_by_type(HWLOC_OBJ_NUMANODE, numNodes - 1);
+      // Work next to its data is cheaper than across the machine
+      const auto local = cost.score(first.get_cpuset(), first.get_nodeset());
+      const auto remote = cost.score(first.get_cpuset(), last.get_nodeset());
+      std::cout << " local cost " << local << ", remote cost " << remote
+                << std::endl;
+      errors += (local == 1.0 && remote > local) ? 0 : 1;
+      errors += (cost.closest(last.get_nodeset(), machine.get_object()
+                                                      .get_nodeset())
+                 == last.get_os_index())
+                    ? 0
+                    : 1;
+   }
+
+   /* Distances provided for some of the nodes only: the others are
+    * unknown, and never picked as the closest over known ones
+    */
+   hwlocxx::topology three{hwlocxx::topology::synthetic{"pack:3 numa:1 pu:1"}};
+   auto addMatrix = [&](unsigned long kind, unsigned n,
+                        std::vector<hwloc_uint64_t> values) {
+      std::vector<hwloc_obj_t> nodes;
+      for (unsigned i = 0; i < n; i++) {
+         nodes.push_back(
+             hwloc_get_obj_by_type(three.get(), HWLOC_OBJ_NUMANODE, i));
+      }
+      auto handle = hwloc_distances_add_create(
+          three.get(), nullptr, HWLOC_DISTANCES_KIND_FROM_USER | kind, 0);
+      return handle
+             && hwloc_distances_add_values(three.get(), handle, n,
+                                           nodes.data(), values.data(), 0)
+                    == 0
+             && hwloc_distances_add_commit(three.get(), handle, 0) == 0;
+   };
+   errors += addMatrix(HWLOC_DISTANCES_KIND_MEANS_LATENCY, 2u,
+                       {10u, 40u, 40u, 10u})
+                 ? 0
+                 : 1;
+   errors += addMatrix(HWLOC_DISTANCES_KIND_MEANS_BANDWIDTH, 3u,
+                       {900u, 300u, 200u, 300u, 900u, 300u, 200u, 300u, 900u})
+                 ? 0
+                 : 1;
+   hwlocxx::experimental::placement_cost partial{three};
+   const auto& bandwidth = partial.bandwidth();
+   errors += (partial.latency().measured() && partial.latency()(0, 2) == 0
+              && bandwidth.measured() && bandwidth.size() == 3u
+              && bandwidth(0, 2) == 200u && bandwidth(1, 1) == 900u)
+                 ? 0
+                 : 1;
+   auto nodeOf = [&](int i) {
+      return three.get_object_by_type(HWLOC_OBJ_NUMANODE, i).get_nodeset();
+   };
+   errors += (partial.closest(nodeOf(0), nodeOf(1) | nodeOf(2)) == 1) ? 0 : 1;
+   errors += (partial.closest(nodeOf(2), nodeOf(1)) == 1) ? 0 : 1;
+   // Unknown latencies cost like local accesses
+   auto firstCPUs =
+       three.get_object_by_type(HWLOC_OBJ_NUMANODE, 0).get_cpuset();
+   errors += (partial.score(firstCPUs, nodeOf(2)) == 1.0) ? 0 : 1;
+
+   // Exit codes only keep 8 bits, so counts of errors could wrap to 0
+   return (errors + wrong.load() > 0) ? 1 : 0;
+}